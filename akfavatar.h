@@ -256,6 +256,19 @@ AVT_API int avt_wait (size_t milliseconds);
 /* counter, which is increased every millisecond */
 AVT_API size_t avt_ticks (void);
 
+/*
+ * monotonic time in nanoseconds, counted from the first call
+ * it doesn't jump, when the system time is changed
+ */
+AVT_API uint_least64_t avt_ticks_ns (void);
+
+/*
+ * sleep until avt_ticks_ns() reaches the deadline
+ * events are handled while waiting
+ * for constant frame rates add the frame time to the last deadline
+ */
+AVT_API int avt_sleep_until (uint_least64_t deadline);
+
 /* returnes elapsed time since start_ticks in milliseconds */
 #define avt_elapsed(start_ticks)  (avt_ticks()-(start_ticks))
 
@@ -486,6 +499,9 @@ AVT_API const wchar_t *avt_wide_license (void);
 
 /*
  * get color number from a given name
+ * case and spaces in names are ignored
+ * also accepts "#RRGGBB", "#RGB", "rgb:r/g/b" (1-4 hex digits each)
+ * and "%h,s,v" (hue in degrees, saturation and value in percent)
  * returns -1 on error
  */
 AVT_API int avt_colorname (const char *name);
@@ -919,10 +935,24 @@ avt_menu (int *result, int items,
           void (*show) (int nr, void *data),
           void *data);
 
+/*
+ * avt_menu_search - like avt_menu with type-ahead
+ * search:        function, which gets the typed characters and returns
+ *                the number of the item to go to, or 0 if none matches
+ *                (a pause in typing starts a new prefix)
+ */
+AVT_API int
+avt_menu_search (int *result, int items,
+                 void (*show) (int nr, void *data),
+                 int (*search) (const wchar_t *prefix, void *data),
+                 void *data);
+
 /*
  * show longer text with a text-viewer application
  * if len is 0, assume 0-terminated string
  * startline is only used, when it is greater than 1
+ * keys: "/" and "?" search, "n" and "N" repeat the search,
+ * "g" goes to a line, "%" to a percentage of the text
  */
 AVT_API int avt_pager (const wchar_t *txt, size_t len, int startline);
 AVT_API int avt_pager_char (const char *txt, size_t len, int startline);
@@ -1129,6 +1159,98 @@ AVT_API avt_char avt_set_pointer_motion_key (avt_char key);
  */
 AVT_API void avt_get_pointer_position (int *x, int *y);
 
+/*
+ * use a pool for graphics, which recycles buffers
+ * this avoids big allocations for temporary graphics
+ * must be called before avt_start to take effect
+ */
+AVT_API void avt_set_graphic_pool (bool);
+
+/*
+ * statistics of the graphic pool
+ * avoided: number of allocations avoided
+ * peak: maximum number of bytes allocated by the pool
+ * both may be NULL
+ */
+AVT_API void avt_graphic_pool_statistics (size_t *avoided, size_t *peak);
+
+/*
+ * number of threads for updating the screen
+ * big areas are then split into bands, which are updated in parallel
+ * 0 or 1 means no extra threads (default)
+ * when called after avt_start, the threads are restarted
+ */
+AVT_API void avt_set_update_threads (int threads);
+
+/*
+ * cache for decoded images from files and XPM arrays
+ * bytes is the budget, 0 disables the cache
+ * the default is 8 MiB
+ */
+AVT_API void avt_set_image_cache (size_t bytes);
+
+/*
+ * XPM arrays are cached by their address and a hash of their contents
+ * this drops the image of an array from the cache at once,
+ * when the array is no longer used
+ */
+AVT_API void avt_image_cache_forget (const void *data);
+
+/*
+ * statistics of the image cache
+ * bytes: bytes currently used by the cache
+ * all may be NULL
+ */
+AVT_API void avt_image_cache_statistics (size_t *hits, size_t *misses,
+                                         size_t *bytes);
+
+/*
+ * performance counters
+ * they count from the start or from the last avt_reset_stats
+ * when the library is built with AVT_NO_STATS, they all stay 0
+ */
+enum avt_stat
+{
+  AVT_STAT_UPDATES,		/* screen areas sent to the backend */
+  AVT_STAT_UPDATE_PIXELS,	/* pixels in those areas */
+  AVT_STAT_UPDATE_NS,		/* nanoseconds spent in the backend updates */
+  AVT_STAT_GLYPHS,		/* characters drawn */
+  AVT_STAT_IMAGE_DECODES,	/* images decoded (not from the cache) */
+  AVT_STAT_IMAGE_DECODE_NS,	/* nanoseconds spent decoding images */
+  AVT_STAT_AUDIO_CALLBACKS,	/* buffers requested by the audio device */
+  AVT_STAT_AUDIO_PARTIAL,	/* buffers only partly filled (end of a sound) */
+  AVT_STAT_COUNT
+};
+
+/*
+ * copies up to count values, indexed by enum avt_stat
+ * returns the number of values copied
+ */
+AVT_API size_t avt_get_stats (uint_least64_t *values, size_t count);
+
+/* short name of a counter, like "updates", or NULL */
+AVT_API const char *avt_stat_name (int nr);
+
+/* sets all counters to 0 */
+AVT_API void avt_reset_stats (void);
+
+/*
+ * tracing in the Chrome trace format (JSON),
+ * which can be viewed with chrome://tracing or Perfetto
+ * the file is written, when tracing is stopped with avt_trace (NULL),
+ * at the exit of the program, or after the signal SIGUSR1
+ * the environment variable AVT_TRACE starts it with avt_start
+ * returns AVT_FAILURE, if tracing is not available
+ */
+AVT_API int avt_trace (const char *filename);
+
+/*
+ * own events, the name must be a constant string
+ * the events of one thread must be properly nested
+ */
+AVT_API void avt_trace_begin (const char *name);
+AVT_API void avt_trace_end (const char *name);
+
 /*
  * get a string with a default text
  *
@@ -1154,6 +1276,16 @@ AVT_API avt_char avt_input_char (char *result, size_t size,
  */
 AVT_API int avt_show_raw_image (void *image_data, int width, int height);
 
+/*
+ * show only a region of a raw image, which was already shown
+ * with avt_show_raw_image and is still on the screen
+ * x and y are relative to the image
+ * otherwise the whole image is shown
+ */
+AVT_API int avt_show_raw_image_region (void *image_data, int width,
+                                       int height, int x, int y,
+                                       int region_width, int region_height);
+
 /*
  * put an image onto a raw image
  * only 4 Bytes per pixel supported (0RGB)
@@ -1170,6 +1302,40 @@ AVT_API int avt_put_raw_image_data (void *img, size_t imgsize, int x, int y,
 AVT_API int avt_put_raw_image_xpm (char **xpm, int x, int y,
                                    void *image_data, int width, int height);
 
+/*
+ * save a raw image as file in the QOI format
+ * only 4 Bytes per pixel supported (0RGB)
+ * On error it returns AVT_FAILURE without changing the status
+ */
+AVT_API int avt_save_raw_image_qoi (const char *file, void *image_data,
+                                    int width, int height);
+
+/*
+ * save a raw image as uncompressed PNG file or as PPM file
+ * only 4 Bytes per pixel supported (0RGB)
+ * On error it returns AVT_FAILURE without changing the status
+ */
+AVT_API int avt_save_raw_image_png (const char *file, void *image_data,
+                                    int width, int height);
+
+AVT_API int avt_save_raw_image_ppm (const char *file, void *image_data,
+                                    int width, int height);
+
+/*
+ * save the whole screen as it is shown
+ * the format depends on the extension of the file:
+ * ".png" for PNG, ".ppm" or ".pnm" for PPM, else QOI
+ * On error it returns AVT_FAILURE without changing the status
+ */
+AVT_API int avt_screenshot (const char *file);
+
+/*
+ * copy the screen into a raw image (0RGB)
+ * the size should be avt_image_max_width() x avt_image_max_height()
+ * a smaller image gets the upper left part
+ */
+AVT_API int avt_screenshot_raw (void *image_data, int width, int height);
+
 
 /***********************************************************************/
 /* deprecated functions - only for backward comatibility */
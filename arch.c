@@ -20,12 +20,18 @@
  */
 
 #include "avtaddons.h"
-#include <unistd.h>
+#include <unistd.h>		/* evtl. defines _POSIX_MAPPED_FILES */
 #include <sys/types.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdint.h>
 #include <iso646.h>
 
+#if _POSIX_MAPPED_FILES+0 > 0
+#include <sys/stat.h>
+#include <sys/mman.h>
+#endif
+
 /*
  * some weird systems need O_BINARY, most others not
  * so I define a dummy value for sane systems
@@ -45,6 +51,38 @@ struct avt_arch_member
   char magic[2];
 };
 
+/* member of an opened archive */
+struct avt_archive_entry
+{
+  const char *name;		/* not terminated */
+  size_t name_length;
+  const char *data;
+  size_t size;
+};
+
+struct avt_archive
+{
+  char *memory;
+  size_t memory_size;
+  bool mapped;
+  size_t count;
+  const struct avt_archive_entry *first;	/* in the order of the archive */
+  size_t mask;			/* hash table size - 1 */
+  struct avt_archive_entry table[];
+};
+
+/* the numbers are decimal and padded with spaces */
+static size_t
+arch_number (const char *s, size_t length)
+{
+  size_t n = 0;
+
+  while (length-- and *s >= '0' and *s <= '9')
+    n = n * 10 + (*s++ - '0');
+
+  return n;
+}
+
 /*
  * return file descriptor, if it's an archive
  * or -1 on error
@@ -72,90 +110,73 @@ avt_arch_open (const char *archive)
 }
 
 
+/*
+ * the old interface works with a file descriptor,
+ * but uses the index, so that it also finds long names
+ */
+static avt_archive *arch_open_fd (int fd);
+static const struct avt_archive_entry *arch_entry (const avt_archive * a,
+						  const char *name,
+						  size_t name_length);
+
+/* leave the file position at the start of the data of a member */
+static size_t
+arch_seek_entry (int fd, const avt_archive * a,
+		 const struct avt_archive_entry *e)
+{
+  if (not e or lseek (fd, e->data - a->memory, SEEK_SET) < 0)
+    return 0;
+
+  return e->size;
+}
+
 /* finds a member in the archive */
 /* returns size of the file, or 0 if not found or on error */
 size_t
 avt_arch_find_member (int fd, const char *member)
 {
-  size_t name_length;
-  size_t skip_size;
-  struct avt_arch_member header;
-
-  name_length = strlen (member);
-
-  if (name_length > 15)
-    return 0;
-
-  lseek (fd, 8, SEEK_SET);	/* go to first entry */
-  if (read (fd, &header, sizeof (header)) != sizeof (header))
-    return 0;
+  avt_archive *a;
+  size_t size;
 
-  /* check magic entry */
-  if (memcmp (&header.magic, "`\n", 2) != 0)
+  a = arch_open_fd (fd);
+  if (not a)
     return 0;
 
-  /* check name */
-  while (memcmp (&header.name, member, name_length) != 0
-	 or (header.name[name_length] != ' '
-	     and header.name[name_length] != '/'))
-    {
-      /* skip block */
-      skip_size = strtoul ((const char *) &header.size, NULL, 10);
-      skip_size += (skip_size % 2);
-      lseek (fd, skip_size, SEEK_CUR);
-
-      /* read next block-header */
-      if (read (fd, &header, sizeof (header)) <= 0)
-	return 0;		/* end reached - not found */
+  size = arch_seek_entry (fd, a, arch_entry (a, member, strlen (member)));
+  avt_archive_close (a);
 
-      /* check magic entry */
-      if (memcmp (&header.magic, "`\n", 2) != 0)
-	return 0;
-    }
-
-  return strtoul ((const char *) &header.size, NULL, 10);
+  return size;
 }
 
 /*
  * finds first archive member
  * if member is not NULL it will get the name of the member
- * member must have at least 16 bytes
+ * member must have at least 16 bytes, longer names are returned empty
  * returns size of first member
  */
 size_t
 avt_arch_first_member (int fd, char *member)
 {
+  avt_archive *a;
   size_t size;
-  struct avt_arch_member header;
-  char *end;
 
-  lseek (fd, 8, SEEK_SET);	/* go to first entry */
-  if (read (fd, &header, sizeof (header)) != sizeof (header))
-    return 0;
+  if (member != NULL)
+    *member = '\0';
 
-  /* check magic entry */
-  if (memcmp (&header.magic, "`\n", 2) != 0)
+  a = arch_open_fd (fd);
+  if (not a)
     return 0;
 
-  size = strtoul ((const char *) &header.size, NULL, 10);
+  size = arch_seek_entry (fd, a, a->first);
 
-  if (member != NULL)
+  if (size and member != NULL and a->first->name_length < 16)
     {
-      memcpy (member, header.name, sizeof (header.name));
-
-      /* find end of the name */
-      /* either terminated by / or by space */
-      end = (char *) memchr (member, '/', sizeof (header.name));
-
-      if (not end)
-	end = (char *) memchr (member, ' ', sizeof (header.name));
-
-      if (end)
-	*end = '\0';		/* make it a valid C-string */
-      else
-	*member = '\0';
+      memcpy (member, a->first->name, a->first->name_length);
+      member[a->first->name_length] = '\0';
     }
 
+  avt_archive_close (a);
+
   return size;
 }
 
@@ -215,7 +236,8 @@ avt_arch_get_member (int fd, size_t size)
 char *
 avt_arch_get_data (const char *archive, const char *member, size_t * size)
 {
-  int fd;
+  avt_archive *a;
+  const char *data;
   size_t msize;
   char *buf;
 
@@ -223,16 +245,25 @@ avt_arch_get_data (const char *archive, const char *member, size_t * size)
   if (size)
     *size = 0;
 
-  fd = avt_arch_open (archive);
-  if (fd < 0)
+  a = avt_archive_open (archive);
+  if (not a)
     return NULL;
 
-  msize = avt_arch_find_member (fd, member);
+  data = avt_archive_member (a, member, &msize);
 
-  if (msize > 0)
-    buf = avt_arch_get_member (fd, msize);
+  if (data and msize > 0)
+    {
+      /* we add 4 0-Bytes as possible string-terminator */
+      buf = (char *) malloc (msize + 4);
 
-  close (fd);
+      if (buf)
+	{
+	  memcpy (buf, data, msize);
+	  memset (buf + msize, '\0', 4);
+	}
+    }
+
+  avt_archive_close (a);
 
   if (not buf)
     msize = 0;
@@ -242,3 +273,398 @@ avt_arch_get_data (const char *archive, const char *member, size_t * size)
 
   return buf;
 }
+
+
+/**********************************************************************/
+/* archive handle */
+
+/* FNV-1a */
+static size_t
+arch_hash (const char *name, size_t length)
+{
+  uint_least32_t hash = 2166136261u;
+
+  while (length--)
+    hash = ((hash xor (unsigned char) *name++) * 16777619u) bitand 0xFFFFFFFFu;
+
+  return hash;
+}
+
+static void
+arch_insert (avt_archive * a, const char *name, size_t name_length,
+	     const char *data, size_t size)
+{
+  size_t i;
+
+  i = arch_hash (name, name_length) bitand a->mask;
+
+  /* the first one wins, like in a sequential search */
+  while (a->table[i].name)
+    {
+      if (a->table[i].name_length == name_length
+	  and memcmp (a->table[i].name, name, name_length) == 0)
+	return;
+
+      i = (i + 1) bitand a->mask;
+    }
+
+  a->table[i].name = name;
+  a->table[i].name_length = name_length;
+  a->table[i].data = data;
+  a->table[i].size = size;
+
+  if (not a->first)
+    a->first = &a->table[i];
+
+  a->count++;
+}
+
+/*
+ * get the name of a member
+ * handles the GNU and the BSD variants for long names
+ * data and size are adjusted for BSD long names
+ * returns false for special members (symbol table, names table)
+ */
+static bool
+arch_member_name (const struct avt_arch_member *header,
+		  const char *long_names, size_t long_names_size,
+		  const char **name, size_t *name_length,
+		  const char **data, size_t *size)
+{
+  const char *n;
+  size_t length;
+
+  n = header->name;
+
+  if (n[0] == '/')
+    {
+      size_t offset;
+
+      /* symbol table or table of long names */
+      if (n[1] < '0' or n[1] > '9')
+	return false;
+
+      /* GNU: "/offset" into the table of long names */
+      offset = arch_number (n + 1, sizeof (header->name) - 1);
+
+      if (not long_names or offset >= long_names_size)
+	return false;
+
+      n = long_names + offset;
+
+      for (length = 0; offset + length < long_names_size
+	   and n[length] != '/' and n[length] != '\n'; length++)
+	;
+    }
+  else if (memcmp (n, "#1/", 3) == 0)
+    {
+      /* BSD: the name follows the header */
+      length = arch_number (n + 3, sizeof (header->name) - 3);
+
+      if (length > *size)
+	return false;
+
+      n = *data;
+      *data += length;
+      *size -= length;
+
+      /* evtl. padded with zeros */
+      while (length and n[length - 1] == '\0')
+	length--;
+    }
+  else
+    {
+      /* either terminated by / or by space */
+      for (length = 0; length < sizeof (header->name)
+	   and n[length] != '/' and n[length] != ' '; length++)
+	;
+    }
+
+  /* BSD symbol tables */
+  if ((length == 9 and memcmp (n, "__.SYMDEF", 9) == 0)
+      or (length == 16 and memcmp (n, "__.SYMDEF SORTED", 16) == 0))
+    return false;
+
+  *name = n;
+  *name_length = length;
+
+  return (length > 0);
+}
+
+/* builds the hash table */
+static avt_archive *
+arch_index (char *memory, size_t memory_size)
+{
+  avt_archive *a;
+  size_t pos, members, table_size;
+  const char *long_names;
+  size_t long_names_size;
+
+  /* count the members */
+  members = 0;
+  pos = 8;
+
+  while (pos + sizeof (struct avt_arch_member) <= memory_size)
+    {
+      const struct avt_arch_member *header;
+      size_t size;
+
+      header = (const struct avt_arch_member *) (memory + pos);
+
+      if (memcmp (header->magic, "`\n", 2) != 0)
+	break;
+
+      size = arch_number (header->size, sizeof (header->size));
+      pos += sizeof (*header) + size + (size % 2);
+      members++;
+    }
+
+  table_size = 16;
+  while (table_size < 2 * members)
+    table_size *= 2;
+
+  a = (avt_archive *) calloc (1, sizeof (*a)
+			      + table_size * sizeof (a->table[0]));
+  if (not a)
+    return NULL;
+
+  a->memory = memory;
+  a->memory_size = memory_size;
+  a->mask = table_size - 1;
+
+  long_names = NULL;
+  long_names_size = 0;
+  pos = 8;
+
+  while (members--)
+    {
+      const struct avt_arch_member *header;
+      const char *name, *data;
+      size_t name_length, size;
+
+      header = (const struct avt_arch_member *) (memory + pos);
+      size = arch_number (header->size, sizeof (header->size));
+      data = memory + pos + sizeof (*header);
+      pos += sizeof (*header) + size + (size % 2);
+
+      /* the last member may be truncated */
+      if (size > (size_t) (memory + memory_size - data))
+	size = memory + memory_size - data;
+
+      /* GNU: table of long names */
+      if (memcmp (header->name, "// ", 3) == 0)
+	{
+	  long_names = data;
+	  long_names_size = size;
+	}
+      else if (arch_member_name (header, long_names, long_names_size,
+				 &name, &name_length, &data, &size))
+	arch_insert (a, name, name_length, data, size);
+    }
+
+  return a;
+}
+
+/* read the whole file, when it cannot be mapped */
+static char *
+arch_read_fd (int fd, size_t *size)
+{
+  char *memory, *new_memory;
+  size_t capacity;
+  ssize_t nread;
+
+  *size = 0;
+  capacity = 0;
+  memory = NULL;
+
+  if (lseek (fd, 0, SEEK_SET) < 0)
+    return NULL;
+
+  do
+    {
+      if (*size == capacity)
+	{
+	  capacity = capacity ? 2 * capacity : 16 * 1024;
+	  new_memory = (char *) realloc (memory, capacity);
+
+	  if (not new_memory)
+	    {
+	      free (memory);
+	      return NULL;
+	    }
+
+	  memory = new_memory;
+	}
+
+      nread = read (fd, memory + *size, capacity - *size);
+      if (nread > 0)
+	*size += nread;
+    }
+  while (nread > 0);
+
+  if (nread < 0)
+    {
+      free (memory);
+      *size = 0;
+      return NULL;
+    }
+
+  return memory;
+}
+
+/*
+ * index an archive from an open file descriptor
+ * the file position is undefined afterwards
+ * returns NULL on error
+ */
+static avt_archive *
+arch_open_fd (int fd)
+{
+  avt_archive *a;
+  char *memory;
+  size_t memory_size;
+  bool mapped;
+
+  memory = NULL;
+  memory_size = 0;
+  mapped = false;
+
+#if _POSIX_MAPPED_FILES+0 > 0
+  {
+    struct stat st;
+
+    if (fstat (fd, &st) == 0 and S_ISREG (st.st_mode)
+	and st.st_size >= 8 and (uintmax_t) st.st_size <= SIZE_MAX)
+      {
+	memory = (char *) mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE,
+				fd, 0);
+
+	if (memory == MAP_FAILED)
+	  memory = NULL;
+	else
+	  {
+	    memory_size = st.st_size;
+	    mapped = true;
+	  }
+      }
+  }
+#endif
+
+  if (not memory)
+    {
+      memory = arch_read_fd (fd, &memory_size);
+
+      if (not memory)
+	return NULL;
+    }
+
+  if (memory_size < 8 or memcmp ("!<arch>\n", memory, 8) != 0)
+    a = NULL;
+  else
+    a = arch_index (memory, memory_size);
+
+  if (not a)
+    {
+#if _POSIX_MAPPED_FILES+0 > 0
+      if (mapped)
+	munmap (memory, memory_size);
+      else
+#endif
+	free (memory);
+
+      return NULL;
+    }
+
+  a->mapped = mapped;
+
+  return a;
+}
+
+/*
+ * open an archive for repeated access
+ * the archive is mapped into memory, when possible
+ * returns NULL on error
+ */
+avt_archive *
+avt_archive_open (const char *archive)
+{
+  avt_archive *a;
+  int fd;
+
+  if (not archive)
+    return NULL;
+
+  fd = open (archive, O_RDONLY | O_BINARY);
+  if (fd < 0)
+    return NULL;
+
+  a = arch_open_fd (fd);
+  close (fd);
+
+  return a;
+}
+
+static const struct avt_archive_entry *
+arch_entry (const avt_archive * a, const char *name, size_t name_length)
+{
+  size_t i;
+
+  i = arch_hash (name, name_length) bitand a->mask;
+
+  while (a->table[i].name)
+    {
+      const struct avt_archive_entry *e = &a->table[i];
+
+      if (e->name_length == name_length
+	  and memcmp (e->name, name, name_length) == 0)
+	return e;
+
+      i = (i + 1) bitand a->mask;
+    }
+
+  return NULL;
+}
+
+/*
+ * get a member of an opened archive
+ * the result points into the archive and is not terminated,
+ * it is valid until the archive is closed
+ * returns NULL, if not found
+ */
+const char *
+avt_archive_member (avt_archive * archive, const char *member, size_t *size)
+{
+  const struct avt_archive_entry *e;
+
+  if (size)
+    *size = 0;
+
+  if (not archive or not member)
+    return NULL;
+
+  e = arch_entry (archive, member, strlen (member));
+
+  if (not e)
+    return NULL;
+
+  if (size)
+    *size = e->size;
+
+  return e->data;
+}
+
+void
+avt_archive_close (avt_archive * archive)
+{
+  if (not archive)
+    return;
+
+#if _POSIX_MAPPED_FILES+0 > 0
+  if (archive->mapped)
+    munmap (archive->memory, archive->memory_size);
+  else
+#endif
+    free (archive->memory);
+
+  free (archive);
+}
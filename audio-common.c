@@ -631,6 +631,37 @@ avt_fetch_audio_data (avt_data * src, int samplingrate,
   return audio;
 }
 
+// play directly from memory or from a mapped file
+static avt_audio *
+avt_memory_audio (avt_data * src, size_t maxsize,
+		  int samplingrate, int audio_type, int channels,
+		  int playmode)
+{
+  const void *memory;
+  size_t size, map_length;
+
+  memory = avt_data_memory (src, &size);
+  if (not memory)
+    return NULL;
+
+  avt_audio *audio;
+  audio = avt_prepare_raw_audio (0, samplingrate, audio_type, channels);
+  if (not audio)
+    return NULL;
+
+  map_length = 0;
+  audio->info.mmap.address = avt_data_take_mapping (src, &map_length);
+  audio->info.mmap.map_length = map_length;
+  audio->done = method_done_mmap;
+  audio->info.mmap.sound = (unsigned char *) memory;
+  audio->info.mmap.length = avt_min (size, maxsize);
+
+  if (playmode != AVT_LOAD)
+    avt_play_audio (audio, playmode);
+
+  return audio;
+}
+
 // find a suitable audio loader
 static avt_audio *
 avt_audio_loader (avt_data * src, size_t audio_size, int samplingrate,
@@ -638,6 +669,13 @@ avt_audio_loader (avt_data * src, size_t audio_size, int samplingrate,
 {
   avt_audio *audio = NULL;
 
+  // memory or mapped file?
+  audio = avt_memory_audio (src, audio_size, samplingrate, audio_type,
+			    channels, playmode);
+
+  if (audio)
+    return audio;
+
   if (avt_data_filenumber (src) < 0)	// already in memory?
     audio = avt_fetch_audio_data (src, samplingrate, audio_type,
 				  channels, playmode);
@@ -73,6 +73,10 @@ get_audio (void *userdata, uint8_t * stream, int len)
   avt_audio *snd = (avt_audio *) current_sound;
   int r;
 
+  avt_count (AVT_STAT_AUDIO_CALLBACKS, 1);
+  avt_trace_thread ("audio");
+  avt_trace_begin ("audio callback");
+
 get_sound:
   r = snd->get (snd, stream, len);
 
@@ -88,6 +92,8 @@ get_sound:
 	}
       else			// no loop
 	{
+	  avt_count (AVT_STAT_AUDIO_PARTIAL, 1);
+
 	  // clear rest of buffer
 	  SDL_memset (stream + r, audiospec.silence, len - r);
 
@@ -95,6 +101,8 @@ get_sound:
 	    audio_ended ();
 	}
     }
+
+  avt_trace_end ("audio callback");
 }
 
 #ifdef AUDIO_S32LSB
@@ -111,6 +119,10 @@ get_audio24 (void *userdata, uint8_t * stream, int len)
   uint8_t *b;
   int r;
 
+  avt_count (AVT_STAT_AUDIO_CALLBACKS, 1);
+  avt_trace_thread ("audio");
+  avt_trace_begin ("audio callback");
+
 get_sound:
   r = snd->get (snd, buffer, (len * 3) / sizeof (*p));
   r /= 3;			// number of samples read
@@ -148,6 +160,8 @@ get_sound:
 	}
       else
 	{
+	  avt_count (AVT_STAT_AUDIO_PARTIAL, 1);
+
 	  // clear rest of buffer
 	  SDL_memset (stream + (r * sizeof (*p)),
 		      audiospec.silence, len - (r * sizeof (*p)));
@@ -156,6 +170,8 @@ get_sound:
 	    audio_ended ();
 	}
     }
+
+  avt_trace_end ("audio callback");
 }
 
 #else // no 32bit support
@@ -174,6 +190,10 @@ get_audio24 (void *userdata, uint8_t * stream, int len)
   uint8_t *b;
   int r;
 
+  avt_count (AVT_STAT_AUDIO_CALLBACKS, 1);
+  avt_trace_thread ("audio");
+  avt_trace_begin ("audio callback");
+
 get_sound:
   r = snd->get (snd, buffer, (len * 3) / sizeof (*p));
   r /= 3;			// number of samples read
@@ -211,9 +231,16 @@ get_sound:
 	  if (len > 0)
 	    goto get_sound;
 	}
-      else if (r <= 0)		// nothing left
-	audio_ended ();
+      else
+	{
+	  avt_count (AVT_STAT_AUDIO_PARTIAL, 1);
+
+	  if (r <= 0)		// nothing left
+	    audio_ended ();
+	}
     }
+
+  avt_trace_end ("audio callback");
 }
 
 
@@ -227,6 +254,10 @@ get_audio32 (void *userdata, uint8_t * stream, int len)
   uint32_t *b;
   int r;
 
+  avt_count (AVT_STAT_AUDIO_CALLBACKS, 1);
+  avt_trace_thread ("audio");
+  avt_trace_begin ("audio callback");
+
 get_sound:
   r = snd->get (snd, buffer, len * (sizeof (*b) / sizeof (*p)));
   r /= sizeof (*b);		// number of samples read
@@ -256,9 +287,16 @@ get_sound:
 	  if (len > 0)
 	    goto get_sound;
 	}
-      else if (r <= 0)		// nothing left
-	audio_ended ();
+      else
+	{
+	  avt_count (AVT_STAT_AUDIO_PARTIAL, 1);
+
+	  if (r <= 0)		// nothing left
+	    audio_ended ();
+	}
     }
+
+  avt_trace_end ("audio callback");
 }
 
 #endif // no 32bit support
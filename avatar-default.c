@@ -1,7 +1,7 @@
 /*
  * AKFAvatar - library for showing an avatar who says things in a balloon
  * This file imports the default avatar image
- * Copyright (c) 2007,2009,2010,2012 Andreas K. Foerster <akf@akfoerster.de>
+ * Copyright (c) 2007,2009,2010,2012,2015 Andreas K. Foerster <akf@akfoerster.de>
  *
  * This file is part of AKFAvatar
  *
@@ -19,11 +19,14 @@
  * along with this program; if not, see <http://www.gnu.org/licenses/>.
  */
 
-#include "data/male_user.xpm"
 #include "akfavatar.h"
+#include "avtinternals.h"
+
+// made from data/male_user.xpm
+#include "male_user_image.h"
 
 extern int
 avt_avatar_image_default (void)
 {
-  return avt_avatar_image_xpm (male_user_xpm);
+  return avt_avatar_image (avt_load_image_prebuilt (&male_user_image));
 }
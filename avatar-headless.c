@@ -0,0 +1,461 @@
+/*
+ * headless backend for AKFAvatar
+ * Copyright (c) 2015 Andreas K. Foerster <akf@akfoerster.de>
+ *
+ * Nothing is shown, the screen is only copied into memory.
+ * It is for benchmarks and automatic tests without a display.
+ *
+ * Keys come from a script, which is fed one key at a time, when the
+ * program waits for a key.  When the script is used up, the program
+ * gets a quit request, so it cannot hang.  The time is virtual,
+ * waiting just advances it.
+ *
+ * Environment variables:
+ * AVT_HEADLESS_SIZE: size of the screen, like "1024x768"
+ * AVT_HEADLESS_KEYS: key script as UTF-8 text, "\n" is Enter
+ *
+ * required standards: C99
+ *
+ * This file is part of AKFAvatar
+ *
+ * AKFAvatar is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * AKFAvatar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+// don't make functions deprecated for this file
+#define _AVT_USE_DEPRECATED
+
+#include "akfavatar.h"
+#include "avtinternals.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <iso646.h>
+
+static bool started;
+static char error_message[256];
+
+// copy of the shown screen
+static struct
+{
+  avt_color *pixels;
+  int width, height;
+} shadow;
+
+// bounding box of the updates since the last avt_headless_damage
+static struct
+{
+  size_t count;
+  int x1, y1, x2, y2;
+} damage;
+
+static const avt_char *script;
+static avt_char *script_buffer;	// from the environment
+
+// horizontal part of the area to update, the lines are given to the bands
+struct headless_area
+{
+  avt_graphic *screen;
+  int x, width;
+};
+
+static void
+band_copy (void *data, int y, int height)
+{
+  struct headless_area *area = (struct headless_area *) data;
+  avt_graphic *screen = area->screen;
+  avt_color *pixels = screen->pixels + (y * screen->width) + area->x;
+  avt_color *dest = shadow.pixels + (y * shadow.width) + area->x;
+
+  for (int ly = 0; ly < height; ly++)
+    {
+      memcpy (dest, pixels, area->width * sizeof (*dest));
+      dest += shadow.width;
+      pixels += screen->width;
+    }
+}
+
+static void
+update_area_headless (avt_graphic * screen, int x, int y, int width,
+		      int height)
+{
+  struct headless_area area;
+  uint_least64_t start;
+
+  start = avt_stat_clock ();
+
+  if (x < 0)
+    {
+      width -= (-x);
+      x = 0;
+    }
+
+  if (x + width > screen->width)
+    width = screen->width - x;
+
+  if (y < 0)
+    {
+      height -= (-y);
+      y = 0;
+    }
+
+  if (y + height > screen->height)
+    height = screen->height - y;
+
+  if (width <= 0 or height <= 0 or x > screen->width or y > screen->height)
+    return;
+
+  if (shadow.width != screen->width or shadow.height != screen->height)
+    {
+      avt_color *pixels;
+
+      pixels = (avt_color *) realloc (shadow.pixels,
+				      (size_t) screen->width * screen->height
+				      * sizeof (*pixels));
+      if (not pixels)
+	return;
+
+      shadow.pixels = pixels;
+      shadow.width = screen->width;
+      shadow.height = screen->height;
+      memset (shadow.pixels, 0,
+	      (size_t) shadow.width * shadow.height * sizeof (*pixels));
+    }
+
+  area.screen = screen;
+  area.x = x;
+  area.width = width;
+
+  // big areas are copied in parallel, if threads are available
+  avt_bands (band_copy, &area, y, width, height);
+
+  if (not damage.count)
+    {
+      damage.x1 = x;
+      damage.y1 = y;
+      damage.x2 = x + width;
+      damage.y2 = y + height;
+    }
+  else
+    {
+      damage.x1 = avt_min (damage.x1, x);
+      damage.y1 = avt_min (damage.y1, y);
+      damage.x2 = avt_max (damage.x2, x + width);
+      damage.y2 = avt_max (damage.y2, y + height);
+    }
+
+  damage.count++;
+
+  avt_count_update (width, height, start);
+}
+
+extern size_t
+avt_headless_damage (int *x, int *y, int *width, int *height)
+{
+  size_t count;
+
+  count = damage.count;
+
+  if (x)
+    *x = count ? damage.x1 : 0;
+
+  if (y)
+    *y = count ? damage.y1 : 0;
+
+  if (width)
+    *width = count ? damage.x2 - damage.x1 : 0;
+
+  if (height)
+    *height = count ? damage.y2 - damage.y1 : 0;
+
+  damage.count = 0;
+
+  return count;
+}
+
+// FNV-1a over the bytes of the shown pixels
+extern uint_least32_t
+avt_headless_checksum (void)
+{
+  uint_least32_t hash = 2166136261u;
+  size_t count;
+
+  count = (size_t) shadow.width * shadow.height;
+
+  for (size_t i = 0; i < count; i++)
+    {
+      avt_color color = shadow.pixels[i];
+
+      for (int b = 0; b < 3; b++, color >>= 8)
+	hash = ((hash xor (color bitand 0xFF)) * 16777619u) bitand 0xFFFFFFFF;
+    }
+
+  return hash;
+}
+
+extern void
+avt_headless_keys (const avt_char * keys)
+{
+  script = keys;
+}
+
+// this version is stripped down
+static avt_char *
+script_from_utf8 (const char *utf8)
+{
+  const unsigned char *u8 = (const unsigned char *) utf8;
+  avt_char *keys, *k;
+
+  keys = (avt_char *) malloc ((strlen (utf8) + 1) * sizeof (*keys));
+  if (not keys)
+    return NULL;
+
+  k = keys;
+
+  while (*u8)
+    {
+      avt_char c;
+
+      if (*u8 <= 0x7Fu)
+	c = *u8++;
+      else if (*u8 <= 0xDFu and u8[1])
+	{
+	  c = ((u8[0] bitand 0x1Fu) << 6) bitor (u8[1] bitand 0x3Fu);
+	  u8 += 2;
+	}
+      else if (*u8 <= 0xEFu and u8[1] and u8[2])
+	{
+	  c = ((u8[0] bitand 0x0Fu) << 12)
+	    bitor ((u8[1] bitand 0x3Fu) << 6) bitor (u8[2] bitand 0x3Fu);
+	  u8 += 3;
+	}
+      else if (*u8 <= 0xF4u and u8[1] and u8[2] and u8[3])
+	{
+	  c = ((u8[0] bitand 0x07u) << 18) bitor ((u8[1] bitand 0x3Fu) << 12)
+	    bitor ((u8[2] bitand 0x3Fu) << 6) bitor (u8[3] bitand 0x3Fu);
+	  u8 += 4;
+	}
+      else
+	break;
+
+      *k++ = (c == '\n') ? AVT_KEY_ENTER : c;
+    }
+
+  *k = AVT_KEY_NONE;
+
+  return keys;
+}
+
+// switch to fullscreen or window mode
+extern void
+avt_switch_mode (int new_mode)
+{
+  (void) new_mode;
+
+  // only 1 mode
+}
+
+extern void
+avt_toggle_fullscreen (void)
+{
+  // only 1 mode
+}
+
+extern int
+avt_get_mode (void)
+{
+  return AVT_FULLSCREENNOSWITCH;
+}
+
+extern int
+avt_update (void)
+{
+  return _avt_STATUS;
+}
+
+extern int
+avt_wait (size_t milliseconds)
+{
+  avt_trace_begin ("wait");
+
+  if (_avt_STATUS == AVT_NORMAL)
+    avt_delay_until (avt_ticks_ns ()
+		     + (uint_least64_t) milliseconds * 1000000u);
+
+  avt_trace_end ("wait");
+
+  return _avt_STATUS;
+}
+
+extern void
+avt_push_key (avt_char key)
+{
+  avt_add_key (key);
+}
+
+static void
+wait_key_headless (void)
+{
+  if (_avt_STATUS != AVT_NORMAL or avt_key_pressed ())
+    return;
+
+  if (script and *script)
+    avt_add_key (*script++);
+  else				// nobody there to press a key
+    _avt_STATUS = AVT_QUIT;
+}
+
+extern void
+avt_reserve_single_keys (bool onoff)
+{
+  (void) onoff;
+}
+
+extern avt_char
+avt_set_pointer_motion_key (avt_char key)
+{
+  (void) key;
+
+  return 0;
+}
+
+// key for pointer buttons 1-3
+extern avt_char
+avt_set_pointer_buttons_key (avt_char key)
+{
+  (void) key;
+
+  return 0;
+}
+
+extern void
+avt_get_pointer_position (int *x, int *y)
+{
+  if (x)
+    *x = 0;
+
+  if (y)
+    *y = 0;
+}
+
+extern void
+avt_set_mouse_visible (bool visible)
+{
+  (void) visible;
+
+  // no mouse
+}
+
+extern char *
+avt_get_error (void)
+{
+  return &error_message[0];
+}
+
+extern void
+avt_set_error (const char *message)
+{
+  // old messages are always completely overwritten
+  // for strncpy I leave the last byte untouched
+
+  if (message and * message)
+    strncpy (error_message, message, sizeof (error_message) - 1);
+  else				// no message
+    memset (error_message, 0, sizeof (error_message));
+}
+
+extern void
+avt_set_title (const char *title, const char *shortname)
+{
+  (void) title;
+  (void) shortname;
+
+  // nothing to do
+}
+
+static void
+quit_headless (void)
+{
+  free (shadow.pixels);
+  memset (&shadow, 0, sizeof (shadow));
+  memset (&damage, 0, sizeof (damage));
+
+  free (script_buffer);
+  script_buffer = NULL;
+  script = NULL;
+
+  avt_virtual_time (false);
+  started = false;
+}
+
+extern int
+avt_start (const char *title, const char *shortname, int window_mode)
+{
+  struct avt_backend *backend;
+  int width, height;
+  const char *env;
+
+  (void) title;
+  (void) shortname;
+  (void) window_mode;
+
+  avt_set_error (NULL);
+
+  // already initialized?
+  if (started)
+    {
+      avt_set_error ("AKFAvatar already initialized");
+      _avt_STATUS = AVT_ERROR;
+      return _avt_STATUS;
+    }
+
+  width = MINIMALWIDTH;
+  height = MINIMALHEIGHT;
+
+  env = getenv ("AVT_HEADLESS_SIZE");
+  if (env and sscanf (env, "%dx%d", &width, &height) != 2)
+    {
+      width = MINIMALWIDTH;
+      height = MINIMALHEIGHT;
+    }
+
+  if (width < MINIMALWIDTH)
+    width = MINIMALWIDTH;
+
+  if (height < MINIMALHEIGHT)
+    height = MINIMALHEIGHT;
+
+  backend = avt_start_common (avt_new_graphic (width, height));
+
+  if (not backend or _avt_STATUS != AVT_NORMAL)
+    {
+      _avt_STATUS = AVT_ERROR;
+      return _avt_STATUS;
+    }
+
+  backend->update_area = update_area_headless;
+  backend->quit = quit_headless;
+  backend->wait_key = wait_key_headless;
+
+  // a script set before the start has precedence
+  env = getenv ("AVT_HEADLESS_KEYS");
+  if (env and not script)
+    script = script_buffer = script_from_utf8 (env);
+
+  avt_virtual_time (true);
+  started = true;
+
+  return _avt_STATUS;
+}
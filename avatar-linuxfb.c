@@ -1,11 +1,19 @@
 /*
  * Linux framebuffer backend for AKFAvatar
- * Copyright (c) 2012,2014 Andreas K. Foerster <akf@akfoerster.de>
+ * Copyright (c) 2012,2014,2015 Andreas K. Foerster <akf@akfoerster.de>
  *
  * This file is only for systems with the kernel Linux.
  * Screen and keyboard are supported, but mouse support is missing.
  * The framebuffer must have 32, 24, 16 or 15 bit per pixel.
  *
+ * Environment variables:
+ * FRAMEBUFFER: the device (default: /dev/fb0)
+ * FRAMEBUFFER_SCALE: render at a lower logical resolution and scale it up
+ *   "auto": biggest integer fraction of the screen, which is big enough
+ *   a number: use the screen size divided by that number, if possible
+ *   "minimal": use the minimal size, keeping the aspect ratio
+ * FRAMEBUFFER_FILTER: "bilinear" for a smooth scaling (default: nearest)
+ *
  * This file is part of AKFAvatar
  *
  * AKFAvatar is free software; you can redistribute it and/or modify
@@ -63,9 +71,7 @@
 
 static struct fb_var_screeninfo var_info;
 static struct fb_fix_screeninfo fix_info;
-static short bytes_per_pixel;
 static int screen_fd, tty;
-static uint_least8_t *fb;	// frame buffer
 static struct termios terminal_settings;
 static char error_message[256];
 static bool reserve_single_keys;
@@ -87,7 +93,7 @@ normalize_coordinates (avt_graphic * screen, int *x, int *y, int *width,
 
   if (*y < 0)
     {
-      height -= (-*y);
+      *height -= (-*y);
       *y = 0;
     }
 
@@ -95,108 +101,33 @@ normalize_coordinates (avt_graphic * screen, int *x, int *y, int *width,
     *height = screen->height - *y;
 }
 
-static void
-update_area_32bit (avt_graphic * screen, int x, int y, int width, int height)
-{
-  normalize_coordinates (screen, &x, &y, &width, &height);
-
-  if (width <= 0 or height <= 0 or x > screen->width or y > screen->height)
-    return;
-
-  avt_color *pixels = screen->pixels + (y * screen->width);
-  uint_least8_t *fbp = fb + y * fix_info.line_length + x * bytes_per_pixel;
-  int x2 = x + width;
-
-  for (int ly = 0; ly < height; ly++)
-    {
-      uint_least32_t *p = (uint_least32_t *) fbp;
-
-      // in this mode it might be superfluous to repack pixels,
-      // but I want to play save
-      for (int lx = x; lx < x2; lx++)
-	{
-	  register avt_color color = pixels[lx];
-
-	  *p++ = (avt_red (color) << var_info.red.offset)
-	    bitor (avt_green (color) << var_info.green.offset)
-	    bitor (avt_blue (color) << var_info.blue.offset);
-	}
-
-      fbp += fix_info.line_length;
-      pixels += screen->width;
-    }
-}
+// converted screen in the framebuffer
+static struct avt_fb framebuffer;
 
 static void
-update_area_24bit (avt_graphic * screen, int x, int y, int width, int height)
+update_area_fb (avt_graphic * screen, int x, int y, int width, int height)
 {
-  normalize_coordinates (screen, &x, &y, &width, &height);
-
-  if (width <= 0 or height <= 0 or x > screen->width or y > screen->height)
-    return;
+  uint_least64_t start;
 
-  avt_color *pixels = screen->pixels + (y * screen->width);
-  uint_least8_t *fbp = fb + y * fix_info.line_length + x * bytes_per_pixel;
-  int x2 = x + width;
+  start = avt_stat_clock ();
 
-  for (int ly = 0; ly < height; ly++)
+  // with the bilinear filter pixels also depend on their left/upper neighbor
+  if (framebuffer.scale.xmap and framebuffer.scale.smooth)
     {
-      uint_least8_t *p = fbp;
-
-      for (int lx = x; lx < x2; lx++)
-	{
-	  register avt_color color = pixels[lx];
-
-	  if (AVT_BIG_ENDIAN == AVT_BYTE_ORDER)
-	    {
-	      *p++ = avt_red (color);
-	      *p++ = avt_green (color);
-	      *p++ = avt_blue (color);
-	    }
-	  else			// little endian
-	    {
-	      *p++ = avt_blue (color);
-	      *p++ = avt_green (color);
-	      *p++ = avt_red (color);
-	    }
-	}
-
-      fbp += fix_info.line_length;
-      pixels += screen->width;
+      x--;
+      y--;
+      width++;
+      height++;
     }
-}
 
-static void
-update_area_16bit (avt_graphic * screen, int x, int y, int width, int height)
-{
   normalize_coordinates (screen, &x, &y, &width, &height);
 
   if (width <= 0 or height <= 0 or x > screen->width or y > screen->height)
     return;
 
-  avt_color *pixels = screen->pixels + (y * screen->width);
-  uint_least8_t *fbp = fb + y * fix_info.line_length + x * bytes_per_pixel;
-  int x2 = x + width;
+  avt_fb_update (&framebuffer, screen, x, y, width, height);
 
-  for (int ly = 0; ly < height; ly++)
-    {
-      uint_least16_t *p = (uint_least16_t *) fbp;
-
-      for (int lx = x; lx < x2; lx++)
-	{
-	  register avt_color color = pixels[lx];
-
-	  *p++ = ((avt_red (color) >> (8 - var_info.red.length)))
-	    << var_info.red.offset
-	    bitor (avt_green (color) >> (8 - var_info.green.length))
-	    << var_info.green.offset
-	    bitor (avt_blue (color) >> (8 - var_info.blue.length))
-	    << var_info.blue.offset;
-	}
-
-      fbp += fix_info.line_length;
-      pixels += screen->width;
-    }
+  avt_count_update (width, height, start);
 }
 
 // switch to fullscreen or window mode
@@ -362,6 +293,8 @@ avt_update (void)
 extern int
 avt_wait (size_t milliseconds)
 {
+  avt_trace_begin ("wait");
+
   if (milliseconds <= 500)
     {
       if (_avt_STATUS == AVT_NORMAL)
@@ -391,6 +324,8 @@ avt_wait (size_t milliseconds)
 	}
     }
 
+  avt_trace_end ("wait");
+
   return _avt_STATUS;
 }
 
@@ -493,10 +428,10 @@ beep (void)
 static void
 quit_fb (void)
 {
-  if (fb and fb != MAP_FAILED)
+  if (framebuffer.pixels and framebuffer.pixels != MAP_FAILED)
     {
-      munmap (fb, fix_info.smem_len);
-      fb = NULL;
+      munmap (framebuffer.pixels, fix_info.smem_len);
+      framebuffer.pixels = NULL;
     }
 
   if (screen_fd > 0)
@@ -514,6 +449,8 @@ quit_fb (void)
       tty = -1;
     }
 
+  avt_fb_unscale (&framebuffer);
+
   avt_bell_function (avt_flash);
 }
 
@@ -586,7 +523,8 @@ avt_start (const char *title, const char *shortname, int window_mode)
   ioctl (screen_fd, FBIOGET_VSCREENINFO, &var_info);
 
   // check screen format
-  if (fix_info.type != FB_TYPE_PACKED_PIXELS or var_info.bits_per_pixel < 15)
+  if (fix_info.type != FB_TYPE_PACKED_PIXELS
+      or not avt_fb_format (&framebuffer, var_info.bits_per_pixel))
     {
       quit_fb ();
       avt_set_error ("unsupported screen format");
@@ -602,11 +540,10 @@ avt_start (const char *title, const char *shortname, int window_mode)
       return _avt_STATUS;
     }
 
-  bytes_per_pixel = (var_info.bits_per_pixel + CHAR_BIT - 1) / CHAR_BIT;
-
-  fb = mmap (NULL, fix_info.smem_len, PROT_WRITE, MAP_SHARED, screen_fd, 0);
+  framebuffer.pixels = mmap (NULL, fix_info.smem_len, PROT_WRITE, MAP_SHARED,
+			    screen_fd, 0);
 
-  if (MAP_FAILED == fb)
+  if (MAP_FAILED == framebuffer.pixels)
     {
       quit_fb ();
       avt_set_error ("mmap failed");
@@ -614,7 +551,17 @@ avt_start (const char *title, const char *shortname, int window_mode)
       return _avt_STATUS;
     }
 
-  posix_madvise (fb, fix_info.smem_len, POSIX_MADV_WILLNEED);
+  posix_madvise (framebuffer.pixels, fix_info.smem_len, POSIX_MADV_WILLNEED);
+
+  framebuffer.width = var_info.xres;
+  framebuffer.height = var_info.yres;
+  framebuffer.line_length = fix_info.line_length;
+  framebuffer.red.offset = var_info.red.offset;
+  framebuffer.red.length = var_info.red.length;
+  framebuffer.green.offset = var_info.green.offset;
+  framebuffer.green.length = var_info.green.length;
+  framebuffer.blue.offset = var_info.blue.offset;
+  framebuffer.blue.length = var_info.blue.length;
 
   // Select UTF-8 mode for input
   AVT_FAILURE_RETRY (write (tty, "\033%G", 3));
@@ -625,41 +572,25 @@ avt_start (const char *title, const char *shortname, int window_mode)
   tcsetattr (tty, TCSANOW, &settings);
   ioctl (tty, KDSETMODE, KD_GRAPHICS);
 
-  backend = avt_start_common (avt_new_graphic (var_info.xres, var_info.yres));
+  int width, height;
+  const char *filter = getenv ("FRAMEBUFFER_FILTER");
+  avt_fb_scale (&framebuffer, getenv ("FRAMEBUFFER_SCALE"),
+		(filter and strcmp (filter, "bilinear") == 0), &width, &height);
 
-  if (not backend or _avt_STATUS != AVT_NORMAL)
-    {
-      quit_fb ();
-      _avt_STATUS = AVT_ERROR;
-      return _avt_STATUS;
-    }
+  backend = avt_start_common (avt_new_graphic (width, height));
 
-  switch (var_info.bits_per_pixel)
+  if (not backend or _avt_STATUS != AVT_NORMAL)
     {
-    case 32:
-      backend->update_area = update_area_32bit;
-      break;
-
-    case 24:
-      backend->update_area = update_area_24bit;
-      break;
-
-    case 16:
-    case 15:
-      backend->update_area = update_area_16bit;
-      break;
-
-    default:
       quit_fb ();
-      avt_set_error ("unsupported screen format");
       _avt_STATUS = AVT_ERROR;
       return _avt_STATUS;
     }
 
+  backend->update_area = update_area_fb;
   backend->quit = quit_fb;
   backend->wait_key = wait_key_fb;
 
-  memset (fb, 0, fix_info.smem_len);
+  memset (framebuffer.pixels, 0, fix_info.smem_len);
 
   avt_bell_function (beep);	// just remove this line, if you don't like it
 
@@ -43,7 +43,7 @@
 #include <iso646.h>
 
 // include images
-#include "akfavatar.xpm"
+#include "akfavatar_image.h"	// made from akfavatar.xpm
 #include "mfinger.xbm"
 #include "mfinger_mask.xbm"
 
@@ -107,12 +107,42 @@ static void avt_analyze_event (SDL_Event * event);
 
 #ifdef SDL2
 
+// locked area of the texture (for avt_bands)
+struct texture_area
+{
+  const avt_color *pixels;	// first pixel in the screen
+  int screen_width;
+  char *texture_pixels;
+  int pitch;
+  int y, width;
+};
+
+static void
+copy_band (void *data, int y, int height)
+{
+  struct texture_area *area = (struct texture_area *) data;
+  const avt_color *pixels;
+  char *texture_pixels;
+
+  pixels = area->pixels + (y - area->y) * area->screen_width;
+  texture_pixels = area->texture_pixels + (y - area->y) * area->pitch;
+
+  while (height--)
+    {
+      SDL_memcpy (texture_pixels, pixels, area->width * sizeof (avt_color));
+      pixels += area->screen_width;
+      texture_pixels += area->pitch;
+    }
+}
+
 // this shall be the only function to update the window/screen
 static void
 update_area_sdl (avt_graphic * screen, int x, int y, int width, int height)
 {
   int screen_width, screen_height;
+  uint_least64_t start;
 
+  start = avt_stat_clock ();
   screen_width = screen->width;
   screen_height = screen->height;
 
@@ -147,21 +177,24 @@ update_area_sdl (avt_graphic * screen, int x, int y, int width, int height)
   void *sdl_screen_pixels;
   SDL_LockTexture (sdl_screen, &rect, &sdl_screen_pixels, &sdl_screen_pitch);
 
-  avt_color *pixels;
-  pixels = screen->pixels + (y * screen_width) + x;
+  struct texture_area area;
+  area.pixels = screen->pixels + (y * screen_width) + x;
+  area.screen_width = screen_width;
+  area.texture_pixels = (char *) sdl_screen_pixels;
+  area.pitch = sdl_screen_pitch;
+  area.y = y;
+  area.width = width;
 
-  while (height--)
-    {
-      SDL_memcpy (sdl_screen_pixels, pixels, width * sizeof (avt_color));
-      pixels += screen_width;
-      sdl_screen_pixels = (char *) sdl_screen_pixels + sdl_screen_pitch;
-    }
+  // big areas are copied in parallel, if threads are available
+  avt_bands (copy_band, &area, y, width, height);
 
   SDL_UnlockTexture (sdl_screen);
 
   SDL_RenderClear (sdl_renderer);
   SDL_RenderCopy (sdl_renderer, sdl_screen, NULL, NULL);
   SDL_RenderPresent (sdl_renderer);
+
+  avt_count_update (width, height, start);
 }
 
 #else // SDL-1.2
@@ -170,11 +203,16 @@ update_area_sdl (avt_graphic * screen, int x, int y, int width, int height)
 static void
 update_area_sdl (avt_graphic * screen, int x, int y, int width, int height)
 {
+  uint_least64_t start;
+
   (void) screen;
+  start = avt_stat_clock ();
 
   // sdl_screen already has the pixel-information of screen
   // other implementations might need to copy pixels here
   SDL_UpdateRect (sdl_screen, x, y, width, height);
+
+  avt_count_update (width, height, start);
 }
 
 #endif // SDL-1.2
@@ -954,6 +992,8 @@ avt_wait (size_t milliseconds)
 
   if (sdl_screen and _avt_STATUS == AVT_NORMAL)
     {
+      avt_trace_begin ("wait");
+
       if (milliseconds <= 500)	// short delay
 	{
 	  if (_avt_STATUS == AVT_NORMAL)
@@ -973,6 +1013,7 @@ avt_wait (size_t milliseconds)
 	      // extremely unlikely error
 	      avt_set_error ("AddTimer doesn't work");
 	      _avt_STATUS = AVT_ERROR;
+	      avt_trace_end ("wait");
 	      return _avt_STATUS;
 	    }
 
@@ -988,6 +1029,8 @@ avt_wait (size_t milliseconds)
 
 	  SDL_RemoveTimer (t);
 	}
+
+      avt_trace_end ("wait");
     }
 
   return _avt_STATUS;
@@ -1214,12 +1257,12 @@ avt_prepare_mouse_cursors (void)
 }
 
 static inline void
-avt_set_icon (char **xpm)
+avt_set_icon (const struct avt_image *image)
 {
   SDL_Surface *icon;
   avt_graphic *gr;
 
-  gr = avt_load_image_xpm (xpm);
+  gr = avt_load_image_prebuilt (image);
   icon = SDL_CreateRGBSurfaceFrom (gr->pixels,
 				   gr->width, gr->height,
 				   CHAR_BIT * sizeof (avt_color),
@@ -1291,7 +1334,7 @@ avt_start (const char *title, const char *shortname, int window_mode)
       return _avt_STATUS;
     }
 
-  avt_set_icon (akfavatar_xpm);
+  avt_set_icon (&akfavatar_image);
 
   SDL_SetWindowMinimumSize (sdl_window, MINIMALWIDTH, MINIMALHEIGHT);
 
@@ -1354,7 +1397,7 @@ avt_start (const char *title, const char *shortname, int window_mode)
     }
 #endif
 
-  avt_set_icon (akfavatar_xpm);
+  avt_set_icon (&akfavatar_image);
   SDL_ClearError ();
 
   if (mode >= 1)
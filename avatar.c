@@ -42,7 +42,7 @@
 #include <wchar.h>
 
 // include images
-#include "btn.xpm"
+#include "btn_image.h"		// made from btn.xpm
 #include "balloonpointer.xbm"
 #include "thinkpointer.xbm"
 #include "round_upper_left.xbm"
@@ -80,6 +80,9 @@
 #  define MOVE_DELAY 1.8
 #endif // MINIMALWIDTH >= 800
 
+// time in nanoseconds for moving a number of pixels
+#define MOVE_NS(pixels)  ((uint_least64_t) ((pixels) * (MOVE_DELAY * 1e6)))
+
 #define BASE_BUTTON_WIDTH 32
 #define BASE_BUTTON_HEIGHT 32
 
@@ -169,6 +172,8 @@ enum avt_button_type
 static avt_graphic *screen;
 static avt_graphic *base_button;
 static avt_graphic *raw_image;
+static struct avt_position raw_image_position;
+static bool raw_image_shown;	// unchanged on the screen
 static avt_graphic *avatar_image;
 static avt_graphic *cursor_character;
 static int fontwidth, fontheight, fontunderline;
@@ -186,6 +191,8 @@ static struct avt_backend backend;
 
 static void (*quit_audio) (void);
 static void (*quit_encoding) (void);
+static bool use_graphic_pool;
+static int update_threads;
 
 static struct avt_settings avt = {
   .background_color = DEFAULT_COLOR,
@@ -329,6 +336,7 @@ static inline void
 avt_free_screen (void)
 {
   avt_fill (screen, avt.background_color);
+  raw_image_shown = false;
 }
 
 static inline avt_graphic *
@@ -341,15 +349,19 @@ avt_get_window (void)
 extern void
 avt_update_all (void)
 {
+  avt_trace_begin ("update_all");
   backend.update_area (screen, 0, 0, screen->width, screen->height);
+  avt_trace_end ("update_all");
   dirty_line = false;
 }
 
 static inline void
 avt_update_window (void)
 {
+  avt_trace_begin ("update_window");
   backend.update_area (screen, window.x, window.y,
 		       window.width, window.height);
+  avt_trace_end ("update_window");
   dirty_line = false;
 }
 
@@ -358,8 +370,10 @@ avt_update_textfield (void)
 {
   if (not avt.hold_updates and textfield.x >= 0)
     {
+      avt_trace_begin ("update_textfield");
       backend.update_area (screen, textfield.x, textfield.y,
 			   textfield.width, textfield.height);
+      avt_trace_end ("update_textfield");
       dirty_line = false;
     }
 }
@@ -369,8 +383,10 @@ avt_update_line (void)
 {
   if (dirty_line and not avt.hold_updates and textfield.x >= 0)
     {
+      avt_trace_begin ("update_line");
       backend.update_area (screen, viewport.x, cursor.y,
 			   viewport.width, fontheight);
+      avt_trace_end ("update_line");
       avt.text_cursor_actually_visible = false;
       dirty_line = false;
     }
@@ -381,8 +397,10 @@ avt_update_viewport (void)
 {
   if (not avt.hold_updates and viewport.x >= 0)
     {
+      avt_trace_begin ("update_viewport");
       backend.update_area (screen, viewport.x, viewport.y,
 			   viewport.width, viewport.height);
+      avt_trace_end ("update_viewport");
       dirty_line = false;
     }
 }
@@ -479,6 +497,7 @@ avt_release_raw_image (void)
     {
       avt_free_graphic (raw_image);
       raw_image = NULL;
+      raw_image_shown = false;
     }
 }
 
@@ -553,7 +572,10 @@ avt_load_image_avtdata (avt_data * data)
   if (not data)
     return NULL;
 
-  image = avt_load_image_xpm_data (data);
+  image = avt_load_image_qoi_data (data);
+
+  if (not image)
+    image = avt_load_image_xpm_data (data);
 
   if (not image)
     image = avt_load_image_xbm_data (data, avt.bitmap_color);
@@ -564,13 +586,31 @@ avt_load_image_avtdata (avt_data * data)
   return image;
 }
 
+// counts successfully decoded images
+static inline avt_graphic *
+avt_decoded (avt_graphic * image, uint_least64_t start)
+{
+  (void) start;
+
+  if (image)
+    {
+      avt_count (AVT_STAT_IMAGE_DECODES, 1);
+      avt_count (AVT_STAT_IMAGE_DECODE_NS, avt_stat_clock () - start);
+      avt_trace_complete ("image_decode", start);
+    }
+
+  return image;
+}
+
 static avt_graphic *
-avt_load_image_file (const char *filename)
+avt_decode_image_file (const char *filename)
 {
   avt_graphic *image;
   avt_data d;
+  uint_least64_t start;
 
   image = NULL;
+  start = avt_stat_clock ();
 
   avt_data_init (&d);
   if (avt_data_open_file (&d, filename))
@@ -580,7 +620,13 @@ avt_load_image_file (const char *filename)
   if (not image and backend.graphic_file)
     image = backend.graphic_file (filename);
 
-  return image;
+  return avt_decoded (image, start);
+}
+
+static avt_graphic *
+avt_load_image_file (const char *filename)
+{
+  return avt_image_cache_file (filename, avt_decode_image_file);
 }
 
 static avt_graphic *
@@ -588,8 +634,10 @@ avt_load_image_stream (avt_stream * stream)
 {
   avt_graphic *image;
   avt_data d;
+  uint_least64_t start;
 
   image = NULL;
+  start = avt_stat_clock ();
 
   avt_data_init (&d);
   if (avt_data_open_stream (&d, (FILE *) stream, false))
@@ -599,7 +647,7 @@ avt_load_image_stream (avt_stream * stream)
   if (not image and backend.graphic_stream)
     image = backend.graphic_stream (stream);
 
-  return image;
+  return avt_decoded (image, start);
 }
 
 static avt_graphic *
@@ -607,8 +655,10 @@ avt_load_image_memory (void *data, size_t size)
 {
   avt_graphic *image;
   avt_data d;
+  uint_least64_t start;
 
   image = NULL;
+  start = avt_stat_clock ();
 
   avt_data_init (&d);
   if (avt_data_open_memory (&d, data, size))
@@ -618,7 +668,7 @@ avt_load_image_memory (void *data, size_t size)
   if (not image and backend.graphic_memory)
     image = backend.graphic_memory (data, size);
 
-  return image;
+  return avt_decoded (image, start);
 }
 
 
@@ -1923,6 +1973,7 @@ avt_drawchar (avt_char ch, avt_graphic * surface)
       or cursor.y > surface->height - fontheight)
     return;
 
+  avt_count (AVT_STAT_GLYPHS, 1);
   font_line = avt_get_font_char ((int) ch);
 
   if (not font_line)
@@ -2591,9 +2642,14 @@ update_menu_bar (int menu_start, int menu_end, int line_nr, int old_line,
     }
 }
 
+/*
+ * select is the item, which is marked at the start (0 for none)
+ * if typed is not NULL, other printable keys end the choice
+ * with the result 0 and the key in typed
+ */
 extern int
-avt_choice (int *result, int start_line, int items, avt_char key,
-	    bool back, bool forward)
+avt_choice_typed (int *result, int start_line, int items, avt_char key,
+		  bool back, bool forward, int select, avt_char * typed)
 {
   int res;			// shadow for result
 
@@ -2643,6 +2699,12 @@ avt_choice (int *result, int start_line, int items, avt_char key,
       update_menu_bar (start_line, end_line, line_nr, old_line, plain_menu);
       old_line = line_nr;
     }
+  else if (select > 0 and select <= items)
+    {
+      line_nr = start_line + select - 1;
+      update_menu_bar (start_line, end_line, line_nr, old_line, plain_menu);
+      old_line = line_nr;
+    }
 
   while (res == -1 and _avt_STATUS == AVT_NORMAL)
     {
@@ -2707,6 +2769,12 @@ avt_choice (int *result, int start_line, int items, avt_char key,
 	      old_line = line_nr;
 	    }
 	}
+      else if (typed and ch >= L' ' and ch != AVT_KEY_DELETE
+	       and (ch < 0xE000 or ch > 0xF8FF))	// not private use
+	{
+	  *typed = ch;
+	  res = 0;
+	}
     }				// while
 
   avt_set_pointer_motion_key (AVT_KEY_NONE);
@@ -2721,6 +2789,14 @@ avt_choice (int *result, int start_line, int items, avt_char key,
   return _avt_STATUS;
 }
 
+extern int
+avt_choice (int *result, int start_line, int items, avt_char key,
+	    bool back, bool forward)
+{
+  return avt_choice_typed (result, start_line, items, key,
+			   back, forward, 0, NULL);
+}
+
 extern void
 avt_lock_updates (bool lock)
 {
@@ -2891,9 +2967,10 @@ avt_is_invisible (wchar_t c)
 	  or c == L'\u200B' or c == L'\u200C' or c == L'\u200D');
 }
 
+// the characters from mark_start to mark_end are highlighted
 static size_t
 avt_pager_line (const wchar_t * txt, size_t pos, size_t len,
-		size_t horizontal)
+		size_t horizontal, size_t mark_start, size_t mark_end)
 {
   const wchar_t *tpos;
 
@@ -2977,15 +3054,294 @@ avt_pager_line (const wchar_t * txt, size_t pos, size_t len,
 	}
 
       if (line_length)
-	avt_say_len (tpos, line_length);
+	{
+	  size_t offset = tpos - txt;
+
+	  if (mark_end > offset and mark_start < offset + line_length)
+	    {
+	      size_t a, b;
+
+	      a = (mark_start > offset) ? mark_start - offset : 0;
+	      b = avt_min (mark_end - offset, line_length);
+
+	      if (a)
+		avt_say_len (tpos, a);
+
+	      avt.inverse = not avt.inverse;
+	      avt_say_len (tpos + a, b - a);
+	      avt.inverse = not avt.inverse;
+
+	      if (line_length > b)
+		avt_say_len (tpos + b, line_length - b);
+	    }
+	  else
+	    avt_say_len (tpos, line_length);
+	}
     }
 
   return pos;
 }
 
+/*
+ * The pager works with an index of the line starts, which is only
+ * built as far as it is needed.  Encoded texts are not converted
+ * as a whole, only the lines, which are shown, get decoded.
+ */
+
+struct avt_pager_text
+{
+  const wchar_t *wide;		// wide text or NULL
+  const char *encoded;		// encoded text or NULL
+  const struct avt_charenc *convert;	// for the encoded text
+  size_t len;			// in characters or bytes
+  size_t *lines;		// positions of the line starts
+  size_t line_count, line_capacity;
+  bool complete;		// all lines are in the index
+  wchar_t *buffer;		// for decoding a line
+  size_t buffer_size;
+  size_t mark_start, mark_end;	// the last match
+  avt_char pattern[4 * AVT_LINELENGTH];	// characters or bytes
+  size_t pattern_length;
+  bool backward;		// direction of the last search
+};
+
+// decodes a character of an encoded text, returns its size in bytes
 static size_t
-avt_pager_screen (const wchar_t * txt, size_t pos, size_t len,
-		  size_t horizontal)
+avt_pager_decode (const struct avt_pager_text *t, size_t pos,
+		  avt_char * ch)
+{
+  const char *s;
+  size_t rest, size;
+  char tail[8];
+
+  s = t->encoded + pos;
+
+  // ASCII is the same in all supported encodings,
+  // except for DEL (0x7F), which is a glyph in cp437
+  if ((unsigned char) *s < 0x7F)
+    {
+      *ch = (unsigned char) *s;
+      return 1;
+    }
+
+  rest = t->len - pos;
+
+  // the decoder must not read beyond the end
+  if (rest < sizeof (tail))
+    {
+      memset (tail, 0, sizeof (tail));
+      memcpy (tail, s, rest);
+      s = tail;
+    }
+
+  size = t->convert->decode (t->convert, ch, s);
+
+  if (size < 1)
+    size = 1;
+  else if (size > rest)
+    size = rest;
+
+  return size;
+}
+
+static inline avt_char
+avt_pager_char_at (const struct avt_pager_text *t, size_t pos, size_t * size)
+{
+  avt_char ch;
+
+  if (t->wide)
+    {
+      *size = 1;
+      return t->wide[pos];
+    }
+
+  *size = avt_pager_decode (t, pos, &ch);
+
+  return ch;
+}
+
+// the same rules as in avt_pager_line
+static size_t
+avt_pager_next_line (const struct avt_pager_text *t, size_t pos)
+{
+  const unsigned char *bytes;
+  avt_char ch;
+  size_t size;
+
+  ch = avt_pager_char_at (t, pos, &size);
+
+  if (avt_is_pagebreak (ch))
+    {
+      pos += size;
+
+      while (pos < t->len)
+	{
+	  ch = avt_pager_char_at (t, pos, &size);
+
+	  if (ch != L'\r' and not avt_is_linebreak (ch))
+	    break;
+
+	  pos += size;
+	}
+
+      return pos;
+    }
+
+  bytes = (const unsigned char *) t->encoded;
+
+  while (pos < t->len)
+    {
+      // fast path for printable ASCII, DEL is left to the decoder
+      if (bytes and bytes[pos] >= 0x20 and bytes[pos] < 0x7F)
+	{
+	  pos++;
+	  continue;
+	}
+
+      ch = avt_pager_char_at (t, pos, &size);
+
+      if (avt_is_linebreak (ch))
+	return pos + size;
+
+      if (avt_is_pagebreak (ch))
+	return pos;
+
+      pos += size;
+    }
+
+  return pos;
+}
+
+// index the lines up to nr (from 0), returns false if there is no such line
+static bool
+avt_pager_index (struct avt_pager_text *t, size_t nr)
+{
+  while (nr >= t->line_count and not t->complete)
+    {
+      size_t pos;
+
+      if (t->line_count)
+	pos = avt_pager_next_line (t, t->lines[t->line_count - 1]);
+      else
+	pos = 0;
+
+      if (pos >= t->len)
+	{
+	  t->complete = true;
+	  break;
+	}
+
+      if (t->line_count >= t->line_capacity)
+	{
+	  size_t capacity;
+	  size_t *lines;
+
+	  capacity = t->line_capacity ? 2 * t->line_capacity : 1024;
+	  lines = (size_t *) realloc (t->lines, capacity * sizeof (size_t));
+
+	  if (not lines)
+	    {
+	      // show what we have
+	      t->complete = true;
+	      break;
+	    }
+
+	  t->lines = lines;
+	  t->line_capacity = capacity;
+	}
+
+      t->lines[t->line_count++] = pos;
+    }
+
+  return (nr < t->line_count);
+}
+
+/*
+ * decode the visible part of a line, returns the number of characters
+ * the mark is translated into positions in the buffer
+ */
+static size_t
+avt_pager_decode_line (struct avt_pager_text *t, size_t pos, size_t end,
+		       size_t horizontal, size_t * mark_start,
+		       size_t * mark_end)
+{
+  size_t max, n;
+  bool marked;
+
+  // enough for the skipped and the visible characters,
+  // even with overstrike and markup
+  max = (4 * horizontal + AVT_LINELENGTH) * 4;
+
+  if (max + 1 > t->buffer_size)
+    {
+      wchar_t *buffer;
+
+      buffer = (wchar_t *) realloc (t->buffer, (max + 1) * sizeof (wchar_t));
+      if (not buffer)
+	return 0;
+
+      t->buffer = buffer;
+      t->buffer_size = max + 1;
+    }
+
+  n = 0;
+  *mark_start = *mark_end = 0;
+  marked = (t->mark_end > pos and t->mark_start < end);
+
+  while (pos < end and n < max)
+    {
+      avt_char ch;
+
+      if (marked and pos <= t->mark_start)
+	*mark_start = n;
+
+      pos += avt_pager_decode (t, pos, &ch);
+
+      if (sizeof (wchar_t) >= 3 or ch <= 0xFFFFu)
+	t->buffer[n++] = (wchar_t) ch;
+      else			// UTF-16 surrogates
+	{
+	  ch -= 0x10000u;
+	  t->buffer[n++] = 0xD800 bitor ((ch >> 10) bitand 0x3FF);
+	  t->buffer[n++] = 0xDC00 bitor (ch bitand 0x3FF);
+	}
+
+      if (marked and pos <= t->mark_end)
+	*mark_end = n;
+    }
+
+  return n;
+}
+
+// show line nr at the cursor position
+static void
+avt_pager_show_line (struct avt_pager_text *t, size_t nr, size_t horizontal)
+{
+  size_t start, end;
+
+  if (not avt_pager_index (t, nr))
+    return;
+
+  start = t->lines[nr];
+  end = avt_pager_index (t, nr + 1) ? t->lines[nr + 1] : t->len;
+
+  if (t->wide)
+    avt_pager_line (t->wide, start, end, horizontal,
+		    t->mark_start, t->mark_end);
+  else
+    {
+      size_t n, mark_start, mark_end;
+
+      n = avt_pager_decode_line (t, start, end, horizontal,
+				 &mark_start, &mark_end);
+
+      if (n)
+	avt_pager_line (t->buffer, 0, n, horizontal, mark_start, mark_end);
+    }
+}
+
+static void
+avt_pager_screen (struct avt_pager_text *t, size_t top, size_t horizontal)
 {
   avt.underlined = avt.bold = false;
   avt.hold_updates = true;
@@ -2996,79 +3352,253 @@ avt_pager_screen (const wchar_t * txt, size_t pos, size_t len,
     {
       cursor.x = linestart;
       cursor.y = line_nr * fontheight + textfield.y;
-      pos = avt_pager_line (txt, pos, len, horizontal);
+      avt_pager_show_line (t, top + line_nr, horizontal);
     }
 
   avt.hold_updates = false;
   avt_update_textfield ();
+}
 
-  return pos;
+// the first line of the last screen
+static size_t
+avt_pager_last_screen (struct avt_pager_text *t)
+{
+  avt_pager_index (t, SIZE_MAX);
+
+  if (t->line_count > (size_t) avt.balloonheight)
+    return t->line_count - avt.balloonheight;
+  else
+    return 0;
 }
 
+// don't go beyond the last screen
 static size_t
-avt_pager_lines_back (const wchar_t * txt, size_t pos, int lines)
+avt_pager_limit (struct avt_pager_text *t, size_t top)
 {
-  if (pos > 0)
-    pos--;			// go to last linebreak
+  if (avt_pager_index (t, top + avt.balloonheight - 1))
+    return top;
+  else
+    return avt_pager_last_screen (t);
+}
+
+// the line, which contains pos
+static size_t
+avt_pager_line_of (struct avt_pager_text *t, size_t pos)
+{
+  size_t low, high;
 
-  lines--;
+  if (not avt_pager_index (t, 0))
+    return 0;
 
-  while (lines--)
+  while (not t->complete and t->lines[t->line_count - 1] <= pos)
+    avt_pager_index (t, t->line_count);
+
+  // binary search
+  low = 0;
+  high = t->line_count;
+
+  while (high - low > 1)
     {
-      if (pos > 0 and avt_is_linebreak (txt[pos]))
-	pos--;			// go before last linebreak
+      size_t middle = low + (high - low) / 2;
 
-      while (pos > 0 and not avt_is_linebreak (txt[pos]))
-	pos--;
+      if (t->lines[middle] <= pos)
+	low = middle;
+      else
+	high = middle;
     }
 
-  if (pos > 0)
-    pos++;
+  return low;
+}
 
-  return pos;
+// character or byte, whatever the text consists of
+static inline avt_char
+avt_pager_unit (const struct avt_pager_text *t, size_t pos)
+{
+  if (t->wide)
+    return (avt_char) t->wide[pos];
+  else
+    return (unsigned char) t->encoded[pos];
 }
 
-extern int
-avt_pager (const wchar_t * txt, size_t len, int startline)
+// the pattern is stored in the same form as the text
+static void
+avt_pager_set_pattern (struct avt_pager_text *t, const wchar_t * s)
 {
-  size_t pos;
-  size_t horizontal;
-  struct avt_settings old_settings;
-  bool quit;
-  struct avt_position button;
+  size_t n = 0;
 
-  if (not screen)
-    return AVT_ERROR;
+  for (; *s and n < sizeof (t->pattern) / sizeof (t->pattern[0]); s++)
+    {
+      avt_char ch;
+      char bytes[8];
+      size_t size;
 
-  // do we actually have something to show?
-  if (not txt or not * txt or _avt_STATUS != AVT_NORMAL)
-    return _avt_STATUS;
+      if (t->wide)
+	{
+	  t->pattern[n++] = (avt_char) * s;
+	  continue;
+	}
 
-  // get len if not given
-  if (len == 0)
-    len = wcslen (txt);
+      ch = (avt_char) * s;
 
-  horizontal = 0;
+      // UTF-16 surrogates
+      if (sizeof (wchar_t) < 3 and ch >= 0xD800 and ch <= 0xDBFF
+	  and s[1] >= 0xDC00 and s[1] <= 0xDFFF)
+	{
+	  ch = 0x10000 + ((ch bitand 0x3FF) << 10) + (s[1] bitand 0x3FF);
+	  s++;
+	}
+
+      size = t->convert->encode (t->convert, bytes, sizeof (bytes), ch);
+
+      // not encodable or too long
+      if (not size
+	  or n + size > sizeof (t->pattern) / sizeof (t->pattern[0]))
+	{
+	  n = 0;
+	  break;
+	}
+
+      for (size_t i = 0; i < size; i++)
+	t->pattern[n++] = (unsigned char) bytes[i];
+    }
+
+  t->pattern_length = n;
+}
 
-  // find startline
-  pos = 0;
-  if (startline > 1)
+/*
+ * Boyer-Moore-Horspool search in the source text
+ * forward from start or backward from before start
+ * the shift table is indexed with the lowest 8 bits,
+ * so it also works for wide characters
+ */
+static bool
+avt_pager_search (struct avt_pager_text *t, size_t start, bool backward)
+{
+  const avt_char *p;
+  size_t shift[256];
+  size_t m, s, i;
+
+  p = t->pattern;
+  m = t->pattern_length;
+
+  if (not m or m > t->len)
+    return false;
+
+  for (i = 0; i < 256; i++)
+    shift[i] = m;
+
+  if (not backward)
     {
-      int nr;
+      for (i = 0; i < m - 1; i++)
+	shift[p[i] bitand 0xFF] = m - 1 - i;
 
-      nr = startline - 1;
-      while (nr > 0 and pos < len)
+      for (s = start; s <= t->len - m;)
 	{
-	  while (pos < len and not avt_is_linebreak (txt[pos]))
-	    pos++;
-	  pos++;
-	  nr--;
+	  avt_char last = avt_pager_unit (t, s + m - 1);
+
+	  if (last == p[m - 1])
+	    {
+	      for (i = 0; i < m - 1 and avt_pager_unit (t, s + i) == p[i]; i++)
+		;
+
+	      if (i == m - 1)
+		break;
+	    }
+
+	  s += shift[last bitand 0xFF];
 	}
+
+      if (s > t->len - m)
+	return false;
     }
+  else				// backward
+    {
+      for (i = m - 1; i > 0; i--)
+	shift[p[i] bitand 0xFF] = i;
+
+      if (not start)
+	return false;
+
+      s = avt_min (start - 1, t->len - m);
+
+      while (true)
+	{
+	  avt_char first = avt_pager_unit (t, s);
+
+	  if (first == p[0])
+	    {
+	      for (i = 1; i < m and avt_pager_unit (t, s + i) == p[i]; i++)
+		;
+
+	      if (i == m)
+		break;
+	    }
 
-  // last screen
-  if (pos >= len)
-    pos = avt_pager_lines_back (txt, len, avt.balloonheight + 1);
+	  if (s < shift[first bitand 0xFF])
+	    return false;
+
+	  s -= shift[first bitand 0xFF];
+	}
+    }
+
+  t->mark_start = s;
+  t->mark_end = s + m;
+
+  return true;
+}
+
+// search from the last match, if it is visible, else from the top line
+static bool
+avt_pager_find (struct avt_pager_text *t, size_t * top, bool backward)
+{
+  size_t start, line;
+
+  start = t->lines[*top];
+
+  if (t->mark_end > t->mark_start)
+    {
+      line = avt_pager_line_of (t, t->mark_start);
+
+      if (line >= *top and line < *top + avt.balloonheight)
+	start = backward ? t->mark_start : t->mark_start + 1;
+    }
+
+  if (not avt_pager_search (t, start, backward))
+    return false;
+
+  line = avt_pager_line_of (t, t->mark_start);
+
+  // scroll only, when the match is not visible
+  if (line < *top or line >= *top + avt.balloonheight)
+    *top = avt_pager_limit (t, line);
+
+  return true;
+}
+
+// input in the last line of the pager
+static avt_char
+avt_pager_prompt (const wchar_t * prompt, wchar_t * s, size_t size)
+{
+  cursor.x = linestart;
+  cursor.y = (avt.balloonheight - 1) * fontheight + textfield.y;
+  avt_bar (screen, textfield.x, cursor.y, textfield.width, fontheight,
+	   avt.text_background_color);
+  avt_say (prompt);
+
+  return avt_input (s, size, NULL, -1, 0);
+}
+
+static int
+avt_pager_run (struct avt_pager_text *t, int startline)
+{
+  size_t top;
+  size_t horizontal;
+  struct avt_settings old_settings;
+  bool quit;
+  struct avt_position button;
+
+  horizontal = 0;
+  top = (startline > 1) ? (size_t) startline - 1 : 0;
 
   if (textfield.x < 0)
     avt_draw_balloon ();
@@ -3104,21 +3634,17 @@ avt_pager (const wchar_t * txt, size_t len, int startline)
   avt.underlined = avt.bold = avt.inverse = false;
 
   // show first screen
-  pos = avt_pager_screen (txt, pos, len, horizontal);
-
-  // last screen
-  if (pos >= len)
-    {
-      pos = avt_pager_lines_back (txt, len, avt.balloonheight + 1);
-      pos = avt_pager_screen (txt, pos, len, horizontal);
-    }
+  top = avt_pager_limit (t, top);
+  avt_pager_screen (t, top, horizontal);
 
   quit = false;
   avt_clear_keys ();
 
   while (not quit and _avt_STATUS == AVT_NORMAL)
     {
-      switch (avt_get_key ())
+      avt_char ch = avt_get_key ();
+
+      switch (ch)
 	{
 	case AVT_KEY_ESCAPE:	// needed for the button
 	case L'q':
@@ -3128,13 +3654,14 @@ avt_pager (const wchar_t * txt, size_t len, int startline)
 
 	case AVT_KEY_DOWN:
 	case L'2':
-	  if (pos < len)	// if it's not the end
+	  if (avt_pager_index (t, top + avt.balloonheight))  // not the end
 	    {
+	      top++;
 	      avt.hold_updates = true;
 	      avt_delete_lines (1, 1);
 	      cursor.x = linestart;
 	      cursor.y = (avt.balloonheight - 1) * fontheight + textfield.y;
-	      pos = avt_pager_line (txt, pos, len, horizontal);
+	      avt_pager_show_line (t, top + avt.balloonheight - 1, horizontal);
 	      avt.hold_updates = false;
 	      avt_update_textfield ();
 	    }
@@ -3142,69 +3669,64 @@ avt_pager (const wchar_t * txt, size_t len, int startline)
 
 	case AVT_KEY_UP:
 	case L'8':
-	  {
-	    int start_pos;
-
-	    start_pos =
-	      avt_pager_lines_back (txt, pos, avt.balloonheight + 2);
-
-	    if (start_pos == 0)
-	      pos = avt_pager_screen (txt, 0, len, horizontal);
-	    else
-	      {
-		avt.hold_updates = true;
-		avt.underlined = avt.bold = false;
-		avt_insert_lines (1, 1);
-		cursor.x = linestart;
-		cursor.y = textfield.y;
-		avt_pager_line (txt, start_pos, len, horizontal);
-		avt.hold_updates = false;
-		avt_update_textfield ();
-		pos = avt_pager_lines_back (txt, pos, 2);
-	      }
-	  }
+	  if (top > 0)
+	    {
+	      top--;
+	      avt.hold_updates = true;
+	      avt.underlined = avt.bold = false;
+	      avt_insert_lines (1, 1);
+	      cursor.x = linestart;
+	      cursor.y = textfield.y;
+	      avt_pager_show_line (t, top, horizontal);
+	      avt.hold_updates = false;
+	      avt_update_textfield ();
+	    }
 	  break;
 
 	case AVT_KEY_PAGEDOWN:
 	case L'3':
 	case L' ':
 	case L'f':
-	  if (pos < len)
-	    {
-	      pos = avt_pager_screen (txt, pos, len, horizontal);
-	      if (pos >= len)
-		{
-		  pos =
-		    avt_pager_lines_back (txt, len, avt.balloonheight + 1);
-		  pos = avt_pager_screen (txt, pos, len, horizontal);
-		}
-	    }
+	  {
+	    size_t new_top;
+
+	    new_top = avt_pager_limit (t, top + avt.balloonheight);
+
+	    if (new_top != top)
+	      {
+		top = new_top;
+		avt_pager_screen (t, top, horizontal);
+	      }
+	  }
 	  break;
 
 	case AVT_KEY_PAGEUP:
 	case L'9':
 	case L'b':
-	  pos = avt_pager_lines_back (txt, pos, 2 * avt.balloonheight + 1);
-	  pos = avt_pager_screen (txt, pos, len, horizontal);
+	  if (top > (size_t) avt.balloonheight)
+	    top -= avt.balloonheight;
+	  else
+	    top = 0;
+	  avt_pager_screen (t, top, horizontal);
 	  break;
 
 	case AVT_KEY_HOME:
 	case L'7':
 	  horizontal = 0;
-	  pos = avt_pager_screen (txt, 0, len, horizontal);
+	  top = 0;
+	  avt_pager_screen (t, top, horizontal);
 	  break;
 
 	case AVT_KEY_END:
 	case L'1':
-	  pos = avt_pager_lines_back (txt, len, avt.balloonheight + 1);
-	  pos = avt_pager_screen (txt, pos, len, horizontal);
+	  top = avt_pager_last_screen (t);
+	  avt_pager_screen (t, top, horizontal);
 	  break;
 
 	case AVT_KEY_RIGHT:
 	case L'6':
 	  horizontal++;
-	  pos = avt_pager_lines_back (txt, pos, avt.balloonheight + 1);
-	  pos = avt_pager_screen (txt, pos, len, horizontal);
+	  avt_pager_screen (t, top, horizontal);
 	  break;
 
 	case AVT_KEY_LEFT:
@@ -3212,10 +3734,75 @@ avt_pager (const wchar_t * txt, size_t len, int startline)
 	  if (horizontal)
 	    {
 	      horizontal--;
-	      pos = avt_pager_lines_back (txt, pos, avt.balloonheight + 1);
-	      pos = avt_pager_screen (txt, pos, len, horizontal);
+	      avt_pager_screen (t, top, horizontal);
+	    }
+	  break;
+
+	case L'/':
+	case L'?':
+	  {
+	    wchar_t input[AVT_LINELENGTH + 1];
+	    bool backward = (ch == L'?');
+
+	    if (avt_pager_prompt (backward ? L"?" : L"/", input,
+				  sizeof (input)) == AVT_KEY_ENTER
+		and input[0])
+	      {
+		avt_pager_set_pattern (t, input);
+		t->mark_start = t->mark_end = 0;
+		t->backward = backward;
+
+		if (not avt_pager_find (t, &top, backward) and old_settings.bell)
+		  old_settings.bell ();
+	      }
+
+	    avt_pager_screen (t, top, horizontal);
+	  }
+	  break;
+
+	case L'n':
+	case L'N':
+	  if (t->pattern_length)
+	    {
+	      if (not avt_pager_find (t, &top, (ch == L'N') xor t->backward)
+		  and old_settings.bell)
+		old_settings.bell ();
+
+	      avt_pager_screen (t, top, horizontal);
 	    }
 	  break;
+
+	case L'g':
+	case L'%':
+	case L'p':
+	  {
+	    wchar_t input[12];
+	    bool percent = (ch != L'g');
+
+	    if (avt_pager_prompt (percent ? L"%: " : L"#: ", input,
+				  sizeof (input)) == AVT_KEY_ENTER
+		and input[0])
+	      {
+		long int value = wcstol (input, NULL, 10);
+
+		if (value <= 0)
+		  top = 0;
+		else if (not percent)
+		  top = avt_pager_limit (t, (size_t) value - 1);
+		else if (value >= 100)
+		  top = avt_pager_last_screen (t);
+		else
+		  {
+		    size_t pos;
+
+		    pos = t->len / 100 * value + t->len % 100 * value / 100;
+		    top = avt_pager_limit (t, avt_pager_line_of (t, pos));
+		  }
+	      }
+
+	    avt_pager_screen (t, top, horizontal);
+	  }
+	  break;
 	}			// switch (ch)
     }				// while
 
@@ -3227,9 +3814,56 @@ avt_pager (const wchar_t * txt, size_t len, int startline)
   avt = old_settings;
   avt_activate_cursor (avt.text_cursor_visible);
 
+  free (t->lines);
+  free (t->buffer);
+
   return _avt_STATUS;
 }
 
+extern int
+avt_pager (const wchar_t * txt, size_t len, int startline)
+{
+  struct avt_pager_text t;
+
+  if (not screen)
+    return AVT_ERROR;
+
+  // do we actually have something to show?
+  if (not txt or not * txt or _avt_STATUS != AVT_NORMAL)
+    return _avt_STATUS;
+
+  // get len if not given
+  if (len == 0)
+    len = wcslen (txt);
+
+  memset (&t, 0, sizeof (t));
+  t.wide = txt;
+  t.len = len;
+
+  return avt_pager_run (&t, startline);
+}
+
+// the encoding must be compatible to ASCII
+extern int
+avt_pager_encoded (const char *txt, size_t len, int startline,
+		   const struct avt_charenc *convert)
+{
+  struct avt_pager_text t;
+
+  if (not screen)
+    return AVT_ERROR;
+
+  if (not txt or not len or not convert or _avt_STATUS != AVT_NORMAL)
+    return _avt_STATUS;
+
+  memset (&t, 0, sizeof (t));
+  t.encoded = txt;
+  t.convert = convert;
+  t.len = len;
+
+  return avt_pager_run (&t, startline);
+}
+
 // size in Bytes!
 extern avt_char
 avt_input (wchar_t * s, size_t size, const wchar_t * default_text,
@@ -3476,7 +4110,7 @@ avt_move_in (void)
     {
       struct avt_position pos;
       int destination;
-      size_t start_time;
+      uint_least64_t start_time;
 
       pos.x = screen->width;
 
@@ -3486,7 +4120,7 @@ avt_move_in (void)
 	pos.y =
 	  window.y + window.height - avatar_image->height - AVATAR_MARGIN;
 
-      start_time = avt_ticks ();
+      start_time = avt_ticks_ns ();
 
       if (AVT_FOOTER == avt.avatar_mode or AVT_HEADER == avt.avatar_mode)
 	destination =
@@ -3499,7 +4133,8 @@ avt_move_in (void)
 	  int oldx = pos.x;
 
 	  // move
-	  pos.x = screen->width - (avt_elapsed (start_time) / MOVE_DELAY);
+	  pos.x = screen->width
+	    - (int) ((avt_ticks_ns () - start_time) / MOVE_NS (1));
 
 	  if (pos.x != oldx and pos.x > destination)
 	    {
@@ -3522,6 +4157,9 @@ avt_move_in (void)
 		       avt.background_color);
 	    }
 
+	  // wait for the next pixel
+	  avt_delay_until (start_time + MOVE_NS (screen->width - pos.x + 1));
+
 	  // check event
 	  if (avt_update ())
 	    return _avt_STATUS;
@@ -3546,7 +4184,7 @@ avt_move_out (void)
   if (avatar_image)
     {
       struct avt_position pos;
-      size_t start_time;
+      uint_least64_t start_time;
       int start_position;
 
       if (AVT_FOOTER == avt.avatar_mode or AVT_HEADER == avt.avatar_mode)
@@ -3563,7 +4201,7 @@ avt_move_out (void)
 	pos.y =
 	  window.y + window.height - avatar_image->height - AVATAR_MARGIN;
 
-      start_time = avt_ticks ();
+      start_time = avt_ticks_ns ();
 
       // delete (not visibly yet)
       avt_bar (screen, pos.x, pos.y, avatar_image->width,
@@ -3576,7 +4214,8 @@ avt_move_out (void)
 	  oldx = pos.x;
 
 	  // move
-	  pos.x = start_position + (avt_elapsed (start_time) / MOVE_DELAY);
+	  pos.x = start_position
+	    + (int) ((avt_ticks_ns () - start_time) / MOVE_NS (1));
 
 	  if (pos.x != oldx and pos.x < screen->width)
 	    {
@@ -3599,6 +4238,9 @@ avt_move_out (void)
 		       avt.background_color);
 	    }
 
+	  // wait for the next pixel
+	  avt_delay_until (start_time + MOVE_NS (pos.x - start_position + 1));
+
 	  // check event
 	  if (avt_update ())
 	    return _avt_STATUS;
@@ -3989,7 +4631,7 @@ avt_show_image_xpm (char **xpm)
   if (not screen or _avt_STATUS != AVT_NORMAL)
     return _avt_STATUS;
 
-  image = avt_load_image_xpm (xpm);
+  image = avt_image_cache_xpm (xpm);
 
   if (not image)
     {
@@ -4070,6 +4712,86 @@ avt_show_raw_image (void *image_data, int width, int height)
 
   avt_show_image (raw_image);
 
+  raw_image_position.x = (screen->width / 2) - (width / 2);
+  raw_image_position.y = (screen->height / 2) - (height / 2);
+  raw_image_shown = true;
+
+  return _avt_STATUS;
+}
+
+
+extern int
+avt_show_raw_image_region (void *image_data, int width, int height,
+			   int x, int y, int region_width, int region_height)
+{
+  struct avt_position pos;
+
+  if (not screen or _avt_STATUS != AVT_NORMAL or not image_data)
+    return _avt_STATUS;
+
+  pos.x = (screen->width / 2) - (width / 2);
+  pos.y = (screen->height / 2) - (height / 2);
+
+  // is exactly this image still on the screen?
+  if (not raw_image or not raw_image_shown
+      or textfield.x >= 0 or avt.avatar_visible
+      or image_data != raw_image->pixels
+      or width != raw_image->width or height != raw_image->height
+      or pos.x != raw_image_position.x or pos.y != raw_image_position.y)
+    return avt_show_raw_image (image_data, width, height);
+
+  // clip to the image
+  if (x < 0)
+    {
+      region_width += x;
+      x = 0;
+    }
+
+  if (y < 0)
+    {
+      region_height += y;
+      y = 0;
+    }
+
+  if (region_width > width - x)
+    region_width = width - x;
+
+  if (region_height > height - y)
+    region_height = height - y;
+
+  if (region_width <= 0 or region_height <= 0)
+    return _avt_STATUS;
+
+  avt_graphic_segment (raw_image, x, y, region_width, region_height,
+		       screen, pos.x + x, pos.y + y);
+
+  // clip to the screen
+  x += pos.x;
+  y += pos.y;
+
+  if (x < 0)
+    {
+      region_width += x;
+      x = 0;
+    }
+
+  if (y < 0)
+    {
+      region_height += y;
+      y = 0;
+    }
+
+  if (region_width > screen->width - x)
+    region_width = screen->width - x;
+
+  if (region_height > screen->height - y)
+    region_height = screen->height - y;
+
+  if (region_width > 0 and region_height > 0)
+    backend.update_area (screen, x, y, region_width, region_height);
+
+  avt_update ();
+
   return _avt_STATUS;
 }
 
@@ -4200,6 +4922,121 @@ avt_put_raw_image_xpm (char **xpm, int x, int y,
   return _avt_STATUS;
 }
 
+static int
+avt_save_image (const char *file, const avt_graphic * image,
+		bool (*write) (FILE * f, const avt_graphic * image))
+{
+  FILE *f;
+
+  f = fopen (file, "wb");
+
+  if (not f)
+    {
+      avt_set_error ("couldn't open file for writing");
+      return AVT_FAILURE;
+    }
+
+  if (not write (f, image) or fclose (f) != 0)
+    {
+      avt_set_error ("couldn't write file");
+      return AVT_FAILURE;
+    }
+
+  return _avt_STATUS;
+}
+
+static int
+avt_save_raw_image (const char *file, void *image_data,
+		    int width, int height,
+		    bool (*write) (FILE * f, const avt_graphic * image))
+{
+  avt_graphic image;
+
+  if (not file or not * file or not image_data
+      or width < 1 or width > SHRT_MAX or height < 1 or height > SHRT_MAX)
+    {
+      avt_set_error ("save_raw_image");
+      return AVT_FAILURE;
+    }
+
+  memset (&image, 0, sizeof (image));
+  image.width = width;
+  image.height = height;
+  image.transparent = false;
+  image.pixels = (avt_color *) image_data;
+
+  return avt_save_image (file, &image, write);
+}
+
+extern int
+avt_save_raw_image_qoi (const char *file, void *image_data,
+			int width, int height)
+{
+  return avt_save_raw_image (file, image_data, width, height, avt_write_qoi);
+}
+
+extern int
+avt_save_raw_image_png (const char *file, void *image_data,
+			int width, int height)
+{
+  return avt_save_raw_image (file, image_data, width, height, avt_write_png);
+}
+
+extern int
+avt_save_raw_image_ppm (const char *file, void *image_data,
+			int width, int height)
+{
+  return avt_save_raw_image (file, image_data, width, height, avt_write_ppm);
+}
+
+// the format depends on the extension
+extern int
+avt_screenshot (const char *file)
+{
+  const char *ext;
+
+  if (not screen or not file or not * file)
+    {
+      avt_set_error ("screenshot");
+      return AVT_FAILURE;
+    }
+
+  ext = strrchr (file, '.');
+
+  if (ext and strcasecmp (ext, ".png") == 0)
+    return avt_save_image (file, screen, avt_write_png);
+  else if (ext and (strcasecmp (ext, ".ppm") == 0
+		    or strcasecmp (ext, ".pnm") == 0))
+    return avt_save_image (file, screen, avt_write_ppm);
+  else
+    return avt_save_image (file, screen, avt_write_qoi);
+}
+
+extern int
+avt_screenshot_raw (void *image_data, int width, int height)
+{
+  avt_graphic *image;
+
+  if (not screen or not image_data)
+    {
+      avt_set_error ("screenshot");
+      return AVT_FAILURE;
+    }
+
+  image = avt_data_to_graphic (image_data, width, height);
+
+  if (not image)
+    {
+      avt_set_error ("screenshot");
+      return AVT_FAILURE;
+    }
+
+  avt_graphic_segment (screen, 0, 0, width, height, image, 0, 0);
+  avt_free_graphic (image);
+
+  return _avt_STATUS;
+}
+
 
 /*
  * make background transparent
@@ -4262,7 +5099,7 @@ avt_avatar_image_xpm (char **xpm)
 {
   avt_graphic *image;
 
-  image = avt_load_image_xpm (xpm);
+  image = avt_image_cache_xpm (xpm);
 
   if (not image)
     return AVT_FAILURE;
@@ -4299,7 +5136,7 @@ avt_avatar_image_xbm (const unsigned char *bits,
 }
 
 
-static inline int
+extern int
 avt_avatar_image (avt_graphic * image)
 {
   if (not image)
@@ -4529,13 +5366,13 @@ avt_get_scroll_mode (void)
 static void
 avt_credits_up (avt_graphic * last_line)
 {
-  size_t now, next_time, tickinterval;
+  uint_least64_t now, next_time, tickinterval;
   short moved, pixel;
 
   moved = 0;
   pixel = 1;
-  tickinterval = CREDITDELAY;
-  next_time = avt_ticks () + tickinterval;
+  tickinterval = CREDITDELAY * UINT64_C (1000000);
+  next_time = avt_ticks_ns () + tickinterval;
 
   while (moved <= fontheight)
     {
@@ -4554,17 +5391,17 @@ avt_credits_up (avt_graphic * last_line)
 	return;
 
       moved += pixel;
-      now = avt_ticks ();
+      now = avt_ticks_ns ();
 
       if (next_time > now)
-	avt_delay (next_time - now);
+	avt_delay_until (next_time);
       else
 	{
 	  // move more pixels at once and give more time next time
 	  if (pixel < fontheight - moved)
 	    {
 	      ++pixel;
-	      tickinterval += CREDITDELAY;
+	      tickinterval += CREDITDELAY * UINT64_C (1000000);
 	    }
 	}
 
@@ -4690,6 +5527,26 @@ update_area_error (avt_graphic * screen, int x, int y, int width, int height)
   default_error_function ();
 }
 
+// takes effect with avt_start
+extern void
+avt_set_graphic_pool (bool onoff)
+{
+  use_graphic_pool = onoff;
+}
+
+// when already started, the threads are restarted
+extern void
+avt_set_update_threads (int threads)
+{
+  update_threads = threads;
+
+  if (screen)
+    {
+      avt_quit_threads ();
+      avt_start_threads (update_threads);
+    }
+}
+
 extern void
 avt_quit (void)
 {
@@ -4731,6 +5588,10 @@ avt_quit (void)
       backend.quit = NULL;
     }
 
+  avt_image_cache_flush ();
+  avt_graphic_pool (false);
+  avt_quit_threads ();
+
   backend.resize = NULL;
   backend.graphic_file = NULL;
   backend.graphic_stream = NULL;
@@ -4797,7 +5658,13 @@ avt_start_common (avt_graphic * new_screen)
   backend.update_area = update_area_error;
   backend.wait_key = default_error_function;
 
+  // tracing can be activated without changing the program
+  if (getenv ("AVT_TRACE"))
+    avt_trace (getenv ("AVT_TRACE"));
+
   avt_reset ();
+  avt_graphic_pool (use_graphic_pool);
+  avt_start_threads (update_threads);
 
   if (new_screen)
     screen = new_screen;
@@ -4821,7 +5688,7 @@ avt_start_common (avt_graphic * new_screen)
 
   avt_avatar_window ();
   avt_normal_text ();
-  base_button = avt_load_image_xpm (btn_xpm);
+  base_button = avt_load_image_prebuilt (&btn_image);
 
   // set actual balloon size to the maximum size
   avt.balloonheight = avt.balloonmaxheight;
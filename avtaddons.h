@@ -318,7 +318,7 @@ AVT_ADDON int avt_arch_open (const char *archive);
 /*
  * finds a member in the archive 
  * and leaves the fileposition at its start
- * the member name may not be longer than 15 characters 
+ * GNU and BSD style long names are supported
  * returns size of the member, or 0 if not found 
  */
 AVT_ADDON size_t avt_arch_find_member (int fd, const char *member);
@@ -327,7 +327,7 @@ AVT_ADDON size_t avt_arch_find_member (int fd, const char *member);
  * finds first archive member
  * and leaves the fileposition at its start
  * if member is not NULL it will get the name of the member
- * member must have at least 16 bytes
+ * member must have at least 16 bytes, longer names are returned empty
  * returns size of first member
  */
 AVT_ADDON size_t avt_arch_first_member (int fd, char *member);
@@ -350,6 +350,33 @@ AVT_ADDON char *avt_arch_get_member (int fd, size_t size);
 AVT_ADDON char *avt_arch_get_data (const char *archive, const char *member,
                                    size_t *size);
 
+/*
+ * an opened archive with an index of its members
+ * this is faster for getting several members
+ * GNU and BSD style long names are supported
+ */
+typedef struct avt_archive avt_archive;
+
+/*
+ * open an archive for repeated access
+ * the archive is mapped into memory, when possible
+ * returns NULL on error
+ */
+AVT_ADDON avt_archive *avt_archive_open (const char *archive);
+
+/*
+ * get a member of an opened archive
+ * the result points into the archive and is not terminated,
+ * it is valid until the archive is closed
+ * if size is not NULL it gets the size of the member
+ * returns NULL, if not found
+ */
+AVT_ADDON const char *avt_archive_member (avt_archive *archive,
+                                          const char *member, size_t *size);
+
+/* close the archive, the members are no longer valid */
+AVT_ADDON void avt_archive_close (avt_archive *archive);
+
 
 /**********************************************************************
  * Section: avtterm
@@ -0,0 +1,489 @@
+/*
+ * benchmarks for AKFAvatar with the headless backend
+ * Copyright (c) 2015 Andreas K. Foerster <akf@akfoerster.de>
+ *
+ * usage: avtbench [srcdir [megabytes]]
+ * build and run it with "make bench"
+ * megabytes is the biggest size for reading files and pipes (default 64),
+ * for example "make bench BENCH_READ_MB=500"
+ *
+ * Every workload is timed with the real clock, while the library
+ * runs in virtual time, so delays and animations cost nothing.
+ * The checksum of the last screen can be compared between versions.
+ *
+ * required standards: C99, POSIX.1-2001
+ *
+ * This file is part of AKFAvatar
+ *
+ * AKFAvatar is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * AKFAvatar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _ISOC99_SOURCE
+#define _XOPEN_SOURCE 600
+
+#include "akfavatar.h"
+#include "avtaddons.h"
+#include "avtinternals.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+#include <iso646.h>
+
+#define TEMPFILE  "avtbench.tmp"
+#define TERMFILE  TEMPFILE ".term"
+
+#define PAGER_LINES  100000
+#define PAGER_PAGES  1000
+#define TERM_LINES  5000
+#define IMAGE_ROUNDS  20
+#define FRAMES  100
+#define COLOR_ROUNDS  200
+#define READ_MB  64
+#define UPDATE_ROUNDS  500
+#define SCALE_ROUNDS  20
+#define SCALE_WIDTH  3840
+#define SCALE_HEIGHT  2160
+
+static const char *srcdir;
+static avt_char keys[PAGER_PAGES + 100];
+
+static const wchar_t pangram[] =
+  L"The quick brown fox jumps over the lazy dog. "
+  L"Franz jagt im komplett verwahrlosten Taxi quer durch Bayern.";
+
+
+// "\n" is Enter
+static void
+add_keys (avt_char ** k, const char *text)
+{
+  for (; *text; text++)
+    *(*k)++ = (*text == '\n') ? AVT_KEY_ENTER : (avt_char) * text;
+}
+
+// lines with colors for the terminal
+static bool
+write_termfile (const char *name, int lines)
+{
+  FILE *f;
+
+  f = fopen (name, "w");
+  if (not f)
+    return false;
+
+  for (int i = 1; i <= lines; i++)
+    fprintf (f, "\033[3%dm%6d\033[0m \033[1m%ls\033[0m\033[K\r\n",
+	     i % 8, i, pangram);
+
+  return (fclose (f) == 0);
+}
+
+
+static void
+text (void)
+{
+  wchar_t line[256];
+
+  avt_set_balloon_size (0, 0);
+
+  for (int i = 0; i < 300 and avt_get_status () == AVT_NORMAL; i++)
+    {
+      swprintf (line, sizeof (line) / sizeof (*line), L"%d: %ls\n", i,
+		pangram);
+      avt_say (line);
+    }
+
+  avt_clear ();
+}
+
+
+static void
+pager (void)
+{
+  wchar_t *txt;
+  size_t size, len;
+  avt_char *k;
+
+  size = (size_t) PAGER_LINES * 128;
+  txt = (wchar_t *) malloc (size * sizeof (*txt));
+  if (not txt)
+    return;
+
+  len = 0;
+  for (int i = 1; i <= PAGER_LINES; i++)
+    len += swprintf (txt + len, size - len, L"line %d: %ls\n", i, pangram);
+
+  // page through, then search forward and backward
+  k = keys;
+  for (int i = 0; i < PAGER_PAGES; i++)
+    *k++ = L' ';
+  add_keys (&k, "/line 99999\nnnnNN?line 12\nq");
+  *k = AVT_KEY_NONE;
+
+  avt_headless_keys (keys);
+  avt_pager (txt, len, 1);
+  avt_headless_keys (NULL);
+
+  free (txt);
+}
+
+
+static void
+terminal (void)
+{
+  char *argv[] = { "cat", TERMFILE, NULL };
+  int fd;
+
+  avt_set_balloon_size (0, 0);
+  fd = avt_term_start (NULL, argv);
+  if (fd > -1)
+    avt_term_run (fd);
+}
+
+
+static void
+images (void)
+{
+  static const char *const files[] = {
+    "akfoerster.xpm", "gnu-head.xpm", "teacher.xpm", "gnu-head.xbm"
+  };
+  char name[4096];
+
+  // decode every time
+  avt_set_image_cache (0);
+
+  // a QOI file from the screen
+  avt_show_image_file (TEMPFILE ".qoi");
+
+  for (int r = 0; r < IMAGE_ROUNDS; r++)
+    {
+      for (size_t i = 0; i < sizeof (files) / sizeof (*files); i++)
+	{
+	  snprintf (name, sizeof (name), "%s/data/%s", srcdir, files[i]);
+	  avt_show_image_file (name);
+	}
+
+      avt_show_image_file (TEMPFILE ".qoi");
+    }
+}
+
+
+static void
+export (void)
+{
+  for (int r = 0; r < IMAGE_ROUNDS; r++)
+    {
+      avt_screenshot (TEMPFILE ".png");
+      avt_screenshot (TEMPFILE ".qoi");
+    }
+
+  remove (TEMPFILE ".png");
+}
+
+
+// full screen images, every frame different
+static void
+frames (void)
+{
+  uint_least32_t *image;
+  int width, height;
+
+  width = MINIMALWIDTH;
+  height = MINIMALHEIGHT;
+  image = (uint_least32_t *) malloc ((size_t) width * height
+				     * sizeof (*image));
+  if (not image)
+    return;
+
+  for (int f = 0; f < FRAMES; f++)
+    {
+      uint_least32_t *p = image;
+
+      for (int y = 0; y < height; y++)
+	for (int x = 0; x < width; x++)
+	  *p++ = ((x + f) bitand 0xFF) << 16 bitor ((y + f) bitand 0xFF) << 8
+	    bitor ((x xor y) bitand 0xFF);
+
+      avt_show_raw_image (image, width, height);
+    }
+
+  free (image);
+}
+
+
+// full screen updates, split into bands by the update threads
+static void
+updates (void)
+{
+  for (int r = 0; r < UPDATE_ROUNDS; r++)
+    avt_update_all ();
+}
+
+
+/*
+ * the scaling of the framebuffer backend, into a 32 bit framebuffer
+ * in memory of the size SCALE_WIDTH x SCALE_HEIGHT
+ * at that size "auto" is a factor of 3
+ */
+static void
+scaling (void)
+{
+  static const char *const modes[] = { "1", "2", "auto" };
+  struct avt_fb fb;
+  size_t size;
+
+  memset (&fb, 0, sizeof (fb));
+  fb.width = SCALE_WIDTH;
+  fb.height = SCALE_HEIGHT;
+  fb.line_length = SCALE_WIDTH * 4;
+  fb.red.offset = 16;
+  fb.green.offset = 8;
+  fb.blue.offset = 0;
+  fb.red.length = fb.green.length = fb.blue.length = 8;
+  avt_fb_format (&fb, 32);
+
+  size = fb.line_length * SCALE_HEIGHT;
+  fb.pixels = (uint_least8_t *) malloc (size);
+  if (not fb.pixels)
+    return;
+
+  for (size_t m = 0; m < sizeof (modes) / sizeof (*modes); m++)
+    for (int smooth = 0; smooth <= 1; smooth++)
+      {
+	avt_graphic *source;
+	uint_least64_t start;
+	int width, height;
+	avt_color *p;
+
+	avt_fb_scale (&fb, modes[m], smooth, &width, &height);
+
+	source = avt_new_graphic (width, height);
+	if (not source)
+	  break;
+
+	p = source->pixels;
+	for (int y = 0; y < height; y++)
+	  for (int x = 0; x < width; x++)
+	    *p++ = avt_rgb (x, y, x xor y);
+
+	start = avt_clock_ns ();
+
+	for (int r = 0; r < SCALE_ROUNDS; r++)
+	  avt_fb_update (&fb, source, 0, 0, width, height);
+
+	start = avt_clock_ns () - start;
+
+	printf ("scale %-4s %-8s %8.2f ms  %dx%d -> %dx%d\n",
+		modes[m], smooth ? "bilinear" : "nearest", start / 1e6,
+		width, height, fb.scale.xmap ? fb.scale.width : width,
+		fb.scale.xmap ? fb.scale.height : height);
+
+	avt_free_graphic (source);
+      }
+
+  avt_fb_unscale (&fb);
+  free (fb.pixels);
+}
+
+
+static void
+colornames (void)
+{
+  size_t size;
+  int found;
+
+  size = avt_palette_size ();
+  found = 0;
+
+  for (int r = 0; r < COLOR_ROUNDS; r++)
+    for (size_t i = 0; i < size; i++)
+      if (avt_colorname (avt_palette ((int) i, NULL)) >= 0)
+	found++;
+
+  // don't optimize it away
+  if (found == 0)
+    avt_set_error ("no color names found");
+}
+
+
+// a text file of the given size in megabytes
+static bool
+write_textfile (const char *name, int megabytes)
+{
+  FILE *f;
+  long size;
+  char line[128];
+  int length;
+
+  f = fopen (name, "w");
+  if (not f)
+    return false;
+
+  length = snprintf (line, sizeof (line), "%ls\n", pangram);
+  size = (long) megabytes * 1024 * 1024;
+
+  for (long written = 0; written < size; written += length)
+    fwrite (line, 1, avt_min (length, size - written), f);
+
+  return (fclose (f) == 0);
+}
+
+
+// print time and throughput
+static void
+print_read (int megabytes, const char *what, uint_least64_t ns, int length)
+{
+  if (length < 0)
+    printf ("read %4d MB %-4s failed\n", megabytes, what);
+  else
+    printf ("read %4d MB %-4s %8.2f ms %8.1f MB/s\n", megabytes, what,
+	    ns / 1e6, (length / (1024.0 * 1024.0)) / (ns / 1e9));
+}
+
+
+// reads a file of the given size directly and through a pipe
+static bool
+read_size (int megabytes)
+{
+  uint_least64_t start;
+  char *buffer;
+  int length;
+
+  if (not write_textfile (TEMPFILE ".txt", megabytes))
+    {
+      perror ("avtbench");
+      return false;
+    }
+
+  start = avt_clock_ns ();
+  length = avt_read_textfile (TEMPFILE ".txt", &buffer);
+  print_read (megabytes, "file", avt_clock_ns () - start, length);
+  if (length >= 0)
+    free (buffer);
+
+  start = avt_clock_ns ();
+  length = avt_read_command ("cat " TEMPFILE ".txt", &buffer);
+  print_read (megabytes, "pipe", avt_clock_ns () - start, length);
+  if (length >= 0)
+    free (buffer);
+
+  return true;
+}
+
+
+// powers of 4 up to the biggest size, then the biggest size itself
+static void
+read_sizes (int max_megabytes)
+{
+  int last = 0;
+
+  for (int mb = 1; mb <= max_megabytes; mb *= 4)
+    {
+      if (not read_size (mb))
+	break;
+
+      last = mb;
+    }
+
+  if (last and last != max_megabytes)
+    read_size (max_megabytes);
+
+  remove (TEMPFILE ".txt");
+}
+
+
+static void
+measure (const char *name, void (*workload) (void))
+{
+  uint_least64_t start, values[AVT_STAT_COUNT];
+  int x, y, width, height;
+  size_t updates;
+
+  avt_reset_stats ();
+  avt_headless_damage (NULL, NULL, NULL, NULL);
+
+  start = avt_clock_ns ();
+  workload ();
+  start = avt_clock_ns () - start;
+
+  avt_get_stats (values, AVT_STAT_COUNT);
+  updates = avt_headless_damage (&x, &y, &width, &height);
+
+  printf ("%-12s %10.2f ms %7zu updates %11.0f pixels %8.0f glyphs"
+	  " %5.0f decodes  damage %dx%d+%d+%d\n",
+	  name, start / 1e6, updates,
+	  (double) values[AVT_STAT_UPDATE_PIXELS],
+	  (double) values[AVT_STAT_GLYPHS],
+	  (double) values[AVT_STAT_IMAGE_DECODES], width, height, x, y);
+
+  // a workload may have ended with a quit request
+  avt_set_status (AVT_NORMAL);
+}
+
+
+int
+main (int argc, char *argv[])
+{
+  int read_mb;
+
+  srcdir = (argc > 1) ? argv[1] : ".";
+  read_mb = (argc > 2) ? atoi (argv[2]) : READ_MB;
+
+  if (not write_termfile (TERMFILE, TERM_LINES))
+    {
+      perror ("avtbench");
+      return EXIT_FAILURE;
+    }
+
+  if (avt_start ("avtbench", "avtbench", AVT_WINDOW) != AVT_NORMAL)
+    {
+      fprintf (stderr, "avtbench: %s\n", avt_get_error ());
+      return EXIT_FAILURE;
+    }
+
+  avt_set_text_delay (0);
+  avt_set_flip_page_delay (0);
+
+  measure ("text", text);
+  measure ("pager", pager);
+  measure ("terminal", terminal);
+  measure ("export", export);
+  measure ("images", images);
+  measure ("frames", frames);
+
+  for (int threads = 1; threads <= 8; threads *= 2)
+    {
+      char name[20];
+
+      snprintf (name, sizeof (name), "threads %d", threads);
+      avt_set_update_threads (threads);
+      measure (name, updates);
+    }
+
+  avt_set_update_threads (0);
+  scaling ();
+
+  measure ("colornames", colornames);
+  read_sizes (read_mb);
+
+  printf ("checksum of the last screen: %08lX\n",
+	  (unsigned long) avt_headless_checksum ());
+
+  remove (TERMFILE);
+  remove (TEMPFILE ".qoi");
+  avt_quit ();
+
+  return EXIT_SUCCESS;
+}
@@ -22,6 +22,7 @@
  */
 
 #include "akfavatar.h"
+#include "avtinternals.h"
 #include "avtgraphic.h"
 
 #include <stdlib.h>
@@ -62,6 +63,205 @@ get_left_shift (uint_least32_t mask)
   return shift;
 }
 
+// compression types
+#define BI_RGB        0
+#define BI_RLE8       1
+#define BI_RLE4       2
+#define BI_BITFIELDS  3
+
+// description of the pixel format
+struct bmp_format
+{
+  avt_color palette[256];
+  uint_least32_t red_mask, green_mask, blue_mask;
+  short red_right, green_right, blue_right;
+  short red_left, green_left, blue_left;
+};
+
+// get the data for one row, directly or via the buffer
+static const uint_least8_t *
+get_row (avt_data * src, uint_least8_t * buffer, size_t size)
+{
+  const uint_least8_t *row;
+
+  row = (const uint_least8_t *) avt_data_direct (src, size);
+
+  if (not row)
+    {
+      size_t got = avt_data_read (src, buffer, 1, size);
+
+      // premature end of data
+      if (got < size)
+	memset (buffer + got, 0, size - got);
+
+      row = buffer;
+    }
+
+  return row;
+}
+
+static void
+expand_1bit (avt_color * p, const uint_least8_t * row, int width,
+	     const struct bmp_format *f)
+{
+  for (int x = 0; x < width; x++)
+    p[x] = f->palette[(row[x >> 3] >> (7 - (x bitand 7))) bitand 1];
+}
+
+static void
+expand_4bit (avt_color * p, const uint_least8_t * row, int width,
+	     const struct bmp_format *f)
+{
+  int x;
+
+  for (x = 0; x < width - 1; x += 2, row++)
+    {
+      p[x] = f->palette[*row >> 4];
+      p[x + 1] = f->palette[*row bitand 0xF];
+    }
+
+  if (x < width)
+    p[x] = f->palette[*row >> 4];
+}
+
+static void
+expand_8bit (avt_color * p, const uint_least8_t * row, int width,
+	     const struct bmp_format *f)
+{
+  for (int x = 0; x < width; x++)
+    p[x] = f->palette[row[x]];
+}
+
+static void
+expand_16bit (avt_color * p, const uint_least8_t * row, int width,
+	      const struct bmp_format *f)
+{
+  for (int x = 0; x < width; x++, row += 2)
+    {
+      register uint_least16_t color = row[0] bitor (row[1] << 8);
+
+      p[x] = avt_rgb ((color & f->red_mask) >> f->red_right << f->red_left,
+		      (color & f->green_mask) >> f->green_right
+		      << f->green_left,
+		      (color & f->blue_mask) >> f->blue_right << f->blue_left);
+    }
+}
+
+static void
+expand_24bit (avt_color * p, const uint_least8_t * row, int width,
+	      const struct bmp_format *f)
+{
+  (void) f;
+
+  for (int x = 0; x < width; x++, row += 3)
+    p[x] = avt_rgb (row[2], row[1], row[0]);
+}
+
+static void
+expand_32bit (avt_color * p, const uint_least8_t * row, int width,
+	      const struct bmp_format *f)
+{
+  for (int x = 0; x < width; x++, row += 4)
+    {
+      register uint_least32_t color = row[0] bitor (row[1] << 8)
+	bitor (row[2] << 16) bitor ((uint_least32_t) row[3] << 24);
+
+      p[x] = avt_rgb ((color & f->red_mask) >> f->red_right,
+		      (color & f->green_mask) >> f->green_right,
+		      (color & f->blue_mask) >> f->blue_right);
+    }
+}
+
+// the pixels have the same format as avt_color, except the unused byte
+static void
+expand_32bit_native (avt_color * p, const uint_least8_t * row, int width,
+		     const struct bmp_format *f)
+{
+  (void) f;
+
+  memcpy (p, row, width * sizeof (*p));
+
+  for (int x = 0; x < width; x++)
+    p[x] &= 0xFFFFFFu;
+}
+
+// put an RLE encoded pixel into the image, if it's inside
+static inline void
+rle_pixel (avt_graphic * image, int x, int y, avt_color color)
+{
+  if (x < image->width and y >= 0 and y < image->height)
+    image->pixels[y * image->width + x] = color;
+}
+
+// BI_RLE8 or BI_RLE4
+static void
+decode_rle (avt_data * src, avt_graphic * image, int y, int direction,
+	    bool rle4, const struct bmp_format *f)
+{
+  int x, count, value;
+
+  // skipped pixels get the first color
+  avt_bar (image, 0, 0, image->width, image->height, f->palette[0]);
+
+  x = 0;
+
+  while (y >= 0 and y < image->height)
+    {
+      count = avt_data_getc (src);
+      value = avt_data_getc (src);
+
+      if (value == EOF)
+	break;
+
+      if (count > 0)		// a run
+	{
+	  avt_color first = f->palette[rle4 ? value >> 4 : value];
+	  avt_color second = f->palette[rle4 ? value bitand 0xF : value];
+
+	  for (int i = 0; i < count; i++, x++)
+	    rle_pixel (image, x, y, (i bitand 1) ? second : first);
+	}
+      else if (value == 0)	// end of line
+	{
+	  x = 0;
+	  y += direction;
+	}
+      else if (value == 1)	// end of bitmap
+	break;
+      else if (value == 2)	// delta
+	{
+	  x += avt_data_getc (src);
+	  y += direction * avt_data_getc (src);
+	}
+      else			// absolute mode with value pixels
+	{
+	  int bytes = rle4 ? (value + 1) / 2 : value;
+	  int c = 0;
+
+	  for (int i = 0; i < value; i++, x++)
+	    {
+	      if (not rle4)
+		c = avt_data_getc (src);
+	      else if ((i bitand 1) == 0)
+		c = avt_data_getc (src);
+
+	      if (c == EOF)
+		return;
+
+	      if (rle4)
+		rle_pixel (image, x, y,
+			   f->palette[(i bitand 1) ? c bitand 0xF : c >> 4]);
+	      else
+		rle_pixel (image, x, y, f->palette[c]);
+	    }
+
+	  // padded to 16 bit
+	  if (bytes bitand 1)
+	    avt_data_getc (src);
+	}
+    }
+}
+
 extern avt_graphic *
 avt_load_image_bmp_data (avt_data * src)
 {
@@ -70,12 +270,13 @@ avt_load_image_bmp_data (avt_data * src)
   uint_least32_t bits_offset, info_size, compression;
   uint_least32_t colors_used;
   int_least32_t width, height;
-  uint_least32_t red_mask, green_mask, blue_mask;
   uint_least16_t bits_per_pixel;
-  avt_color palette[256];
+  struct bmp_format f;
+  uint_least8_t *buffer;
 
   image = NULL;
-  red_mask = green_mask = blue_mask = 0;
+  buffer = NULL;
+  f.red_mask = f.green_mask = f.blue_mask = 0;
 
   start = avt_data_tell (src);
 
@@ -123,46 +324,69 @@ avt_load_image_bmp_data (avt_data * src)
       avt_data_seek (src, 4, SEEK_CUR);	// important colors
     }
 
-  // just uncompressed allowed for now
-  if (compression != 0 and compression != 3)
+  // check format
+  if (width < 1 or width > 0x7FFF or height == 0 or abs (height) > 0x7FFF)
     goto done;
 
-  if (compression == 3)
+  switch (compression)
+    {
+    case BI_RGB:
+      if (bits_per_pixel != 1 and bits_per_pixel != 4
+	  and bits_per_pixel != 8 and bits_per_pixel != 16
+	  and bits_per_pixel != 24 and bits_per_pixel != 32)
+	goto done;
+      break;
+
+    case BI_RLE8:
+      if (bits_per_pixel != 8)
+	goto done;
+      break;
+
+    case BI_RLE4:
+      if (bits_per_pixel != 4)
+	goto done;
+      break;
+
+    case BI_BITFIELDS:
+      if (bits_per_pixel != 16 and bits_per_pixel != 32)
+	goto done;
+      break;
+
+    default:
+      goto done;
+    }
+
+  if (compression == BI_BITFIELDS)
     {
       // masks, just for 16 or 32 bit per pixel allowed
-      red_mask = avt_data_read32 (src);
-      green_mask = avt_data_read32 (src);
-      blue_mask = avt_data_read32 (src);
+      f.red_mask = avt_data_read32 (src);
+      f.green_mask = avt_data_read32 (src);
+      f.blue_mask = avt_data_read32 (src);
+
+      if (not f.red_mask or not f.green_mask or not f.blue_mask)
+	goto done;
     }
   else if (bits_per_pixel <= 8)
     {
       // read palette
       // a palette is required when bits per pixel <= 8
+      uint_least8_t entries[256 * 4];
+      size_t entry_size = (info_size != 12) ? 4 : 3;	// OS/2: 3
 
       //  skip end of header
       avt_data_seek (src, start + 14 + info_size, SEEK_SET);
 
-      if (colors_used == 0)
+      if (colors_used == 0 or colors_used > (1u << bits_per_pixel))
 	colors_used = 1 << bits_per_pixel;
 
-      memset (palette, 0, sizeof (palette));
+      memset (f.palette, 0, sizeof (f.palette));
+      memset (entries, 0, sizeof (entries));
+      avt_data_read (src, entries, entry_size, colors_used);
 
-      if (info_size != 12)
-	{
-	  for (uint_least16_t color = 0; color < colors_used; color++)
-	    palette[color] = avt_data_read32 (src) bitand 0xFFFFFF;
-	}
-      else			// old OS/2 format
+      for (uint_least16_t color = 0; color < colors_used; color++)
 	{
-	  uint_least8_t red, green, blue;
-
-	  for (uint_least16_t color = 0; color < colors_used; color++)
-	    {
-	      blue = avt_data_read8 (src);
-	      green = avt_data_read8 (src);
-	      red = avt_data_read8 (src);
-	      palette[color] = avt_rgb (red, green, blue);
-	    }
+	  const uint_least8_t *e = entries + color * entry_size;
+	  f.palette[color] = avt_rgb (e[2], e[1], e[0]);
 	}
     }
 
@@ -191,207 +415,99 @@ avt_load_image_bmp_data (avt_data * src)
 
   height = abs (height);
 
+  image = avt_new_graphic (width, height);
+  if (not image)
+    goto done;
+
+  if (compression == BI_RLE8 or compression == BI_RLE4)
+    {
+      decode_rle (src, image, y, direction, (compression == BI_RLE4), &f);
+      goto done;
+    }
+
+  void (*expand) (avt_color *, const uint_least8_t *, int,
+		  const struct bmp_format *);
+
   switch (bits_per_pixel)
     {
     case 1:
-      {
-	image = avt_new_graphic (width, height);
-	if (not image)
-	  goto done;
-
-	int remainder = ((width + 7) / 8) % 4;
-
-	while (y >= 0 and y < height)
-	  {
-	    avt_color *p = image->pixels + y * image->width;
-
-	    for (int x = 0; x < width; x += 8)
-	      {
-		uint_least8_t value = avt_data_read8 (src);
-		uint_least8_t bitmask = 0x80;
-		for (int bit = 0; bit < 8; bit++, bitmask >>= 1)
-		  if (x + bit < width)
-		    *p++ = palette[(value bitand bitmask) != 0];
-	      }
-
-	    if (remainder)
-	      avt_data_seek (src, 4 - remainder, SEEK_CUR);
-
-	    y += direction;
-	  }
-      }
+      expand = expand_1bit;
       break;
 
     case 4:
-      {
-	image = avt_new_graphic (width, height);
-	if (not image)
-	  goto done;
-
-	int remainder = (width / 2 + width % 2) % 4;
-
-	while (y >= 0 and y < height)
-	  {
-	    avt_color *p = image->pixels + y * image->width;
-
-	    for (int x = 0; x < width; x += 2)
-	      {
-		uint_least8_t value = avt_data_read8 (src);
-		*p++ = palette[value >> 4 bitand 0xF];
-		if (x < width - 1)
-		  *p++ = palette[value bitand 0xF];
-	      }
-
-	    if (remainder)
-	      avt_data_seek (src, 4 - remainder, SEEK_CUR);
-
-	    y += direction;
-	  }
-      }
+      expand = expand_4bit;
       break;
 
     case 8:
-      {
-	image = avt_new_graphic (width, height);
-	if (not image)
-	  goto done;
-
-	int remainder = width % 4;
-
-	while (y >= 0 and y < height)
-	  {
-	    avt_color *p = image->pixels + y * image->width;
-
-	    for (int x = 0; x < width; x++, p++)
-	      {
-		uint_least8_t color = avt_data_read8 (src);
-		*p = palette[color];
-	      }
-
-	    if (remainder)
-	      avt_data_seek (src, 4 - remainder, SEEK_CUR);
-
-	    y += direction;
-	  }
-      }
+      expand = expand_8bit;
       break;
 
     case 16:
-      {
-	short red_right, green_right, blue_right;
-	short red_left, green_left, blue_left;
-
-	if (compression != 3)
-	  {
-	    red_mask = 0x7C00;
-	    green_mask = 0x03E0;
-	    blue_mask = 0x001F;
-	  }
-
-	// colors get shifted right and then left again
-	red_right = get_right_shift (red_mask);
-	red_left = get_left_shift (red_mask >> red_right);
-	green_right = get_right_shift (green_mask);
-	green_left = get_left_shift (green_mask >> green_right);
-	blue_right = get_right_shift (blue_mask);
-	blue_left = get_left_shift (blue_mask >> blue_right);
-
-	image = avt_new_graphic (width, height);
-	if (not image)
-	  goto done;
-
-	int remainder = (2 * width) % 4;
-
-	while (y >= 0 and y < height)
-	  {
-	    avt_color *p = image->pixels + y * image->width;
-
-	    for (int x = 0; x < width; x++, p++)
-	      {
-		register uint_least16_t color = avt_data_read16 (src);
-
-		*p = avt_rgb (((color & red_mask) >> red_right << red_left),
-			      ((color & green_mask) >> green_right <<
-			       green_left),
-			      (color & blue_mask) >> blue_right << blue_left);
-	      }
-
-	    if (remainder)
-	      avt_data_seek (src, 4 - remainder, SEEK_CUR);
-
-	    y += direction;
-	  }
-      }
+      if (compression != BI_BITFIELDS)
+	{
+	  f.red_mask = 0x7C00;
+	  f.green_mask = 0x03E0;
+	  f.blue_mask = 0x001F;
+	}
+
+      // colors get shifted right and then left again
+      f.red_right = get_right_shift (f.red_mask);
+      f.red_left = get_left_shift (f.red_mask >> f.red_right);
+      f.green_right = get_right_shift (f.green_mask);
+      f.green_left = get_left_shift (f.green_mask >> f.green_right);
+      f.blue_right = get_right_shift (f.blue_mask);
+      f.blue_left = get_left_shift (f.blue_mask >> f.blue_right);
+      expand = expand_16bit;
       break;
 
     case 24:
-      {
-	uint_least8_t red, green, blue;
+      expand = expand_24bit;
+      break;
 
-	image = avt_new_graphic (width, height);
-	if (not image)
-	  goto done;
+    default:			// 32
+      if (compression != BI_BITFIELDS)
+	{
+	  f.red_mask = 0x00FF0000;
+	  f.green_mask = 0x0000FF00;
+	  f.blue_mask = 0x000000FF;
+	}
 
-	int remainder = (3 * width) % 4;
+      f.red_right = get_right_shift (f.red_mask);
+      f.green_right = get_right_shift (f.green_mask);
+      f.blue_right = get_right_shift (f.blue_mask);
 
-	while (y >= 0 and y < height)
-	  {
-	    avt_color *p = image->pixels + y * image->width;
+      if (AVT_LITTLE_ENDIAN == AVT_BYTE_ORDER
+	  and sizeof (avt_color) == 4 and f.red_mask == 0x00FF0000
+	  and f.green_mask == 0x0000FF00 and f.blue_mask == 0x000000FF)
+	expand = expand_32bit_native;
+      else
+	expand = expand_32bit;
+      break;
+    }
 
-	    for (int x = 0; x < width; x++, p++)
-	      {
-		blue = avt_data_read8 (src);
-		green = avt_data_read8 (src);
-		red = avt_data_read8 (src);
-		*p = avt_rgb (red, green, blue);
-	      }
+  // rows are padded to 32 bit
+  size_t row_size = ((width * bits_per_pixel + 31) / 32) * 4;
 
-	    if (remainder)
-	      avt_data_seek (src, 4 - remainder, SEEK_CUR);
+  buffer = (uint_least8_t *) malloc (row_size);
+  if (not buffer)
+    {
+      avt_free_graphic (image);
+      image = NULL;
+      goto done;
+    }
 
-	    y += direction;
-	  }
-      }
-      break;
+  while (y >= 0 and y < height)
+    {
+      expand (image->pixels + y * image->width,
+	      get_row (src, buffer, row_size), width, &f);
 
-    case 32:
-      {
-	short red_shift, green_shift, blue_shift;
-
-	if (compression != 3)
-	  {
-	    red_mask = 0x00FF0000;
-	    green_mask = 0x0000FF00;
-	    blue_mask = 0x000000FF;
-	  }
-
-	red_shift = get_right_shift (red_mask);
-	green_shift = get_right_shift (green_mask);
-	blue_shift = get_right_shift (blue_mask);
-
-	image = avt_new_graphic (width, height);
-	if (not image)
-	  goto done;
-
-	while (y >= 0 and y < height)
-	  {
-	    avt_color *p = image->pixels + y * image->width;
-
-	    for (int x = 0; x < width; x++, p++)
-	      {
-		register uint_least32_t color = avt_data_read32 (src);
-		*p = avt_rgb (((color & red_mask) >> red_shift),
-			      ((color & green_mask) >> green_shift),
-			      (color & blue_mask) >> blue_shift);
-	      }
-
-	    y += direction;
-	  }
-      }
-      break;
+      y += direction;
     }
 
 done:
+  if (buffer)
+    free (buffer);
+
   if (not image)
     avt_data_seek (src, start, SEEK_SET);
 
@@ -0,0 +1,343 @@
+/*
+ * cache for decoded images for AKFAvatar
+ * Copyright (c) 2015 Andreas K. Foerster <akf@akfoerster.de>
+ *
+ * required standards: C99, POSIX.1-2008 (stat)
+ *
+ * This file is part of AKFAvatar
+ *
+ * AKFAvatar is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * AKFAvatar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Images loaded from files are cached with the name, the device,
+ * the inode, the size and the modification time of the file.
+ * When anything of that changes, the image is loaded again.
+ * XPM arrays are cached by their address and a hash of their
+ * contents, so a changed array or a new one at the same address
+ * is not confused with the old one.  Hashing is much cheaper than
+ * decoding.
+ *
+ * The least recently used images are dropped, when the cache
+ * gets bigger than its budget.  The callers get copies of the images.
+ */
+
+#define _ISOC99_SOURCE
+#define _XOPEN_SOURCE 700
+
+#include "akfavatar.h"
+#include "avtinternals.h"
+#include "avtgraphic.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <iso646.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#define AVT_IMAGE_CACHE_DEFAULT  (8 * 1024 * 1024)
+
+struct avt_cache_entry
+{
+  struct avt_cache_entry *prev, *next;	// most recently used first
+  avt_graphic *image;
+  size_t bytes;
+
+  // key
+  const void *xpm;		// NULL for files
+  uint_least32_t xpm_hash;
+  dev_t device;
+  ino_t inode;
+  off_t size;
+  time_t mtime;
+  long mtime_ns;
+  char name[];
+};
+
+static struct
+{
+  struct avt_cache_entry *first, *last;
+  size_t budget;
+  size_t bytes;
+  size_t hits, misses;
+} cache = {.budget = AVT_IMAGE_CACHE_DEFAULT };
+
+
+static void
+cache_unlink (struct avt_cache_entry *e)
+{
+  if (e->prev)
+    e->prev->next = e->next;
+  else
+    cache.first = e->next;
+
+  if (e->next)
+    e->next->prev = e->prev;
+  else
+    cache.last = e->prev;
+
+  e->prev = e->next = NULL;
+}
+
+
+static void
+cache_remove (struct avt_cache_entry *e)
+{
+  cache_unlink (e);
+  cache.bytes -= e->bytes;
+  avt_free_graphic (e->image);
+  free (e);
+}
+
+
+// move to the front
+static void
+cache_touch (struct avt_cache_entry *e)
+{
+  if (e != cache.first)
+    {
+      cache_unlink (e);
+      e->next = cache.first;
+      cache.first->prev = e;
+      cache.first = e;
+    }
+}
+
+
+static void
+cache_shrink (size_t budget)
+{
+  while (cache.last and cache.bytes > budget)
+    cache_remove (cache.last);
+}
+
+
+// the entry must have its key filled in
+static avt_graphic *
+cache_insert (struct avt_cache_entry *e, avt_graphic * image)
+{
+  e->image = image;
+  e->bytes += (size_t) image->width * image->height * sizeof (avt_color);
+
+  // too big for the cache
+  if (e->bytes > cache.budget)
+    {
+      free (e);
+      return image;
+    }
+
+  cache_shrink (cache.budget - e->bytes);
+
+  e->prev = NULL;
+  e->next = cache.first;
+  if (cache.first)
+    cache.first->prev = e;
+  else
+    cache.last = e;
+  cache.first = e;
+  cache.bytes += e->bytes;
+
+  // the caller gets a copy, which it may change
+  return avt_copy_graphic (image);
+}
+
+
+static inline bool
+cache_same_file (const struct avt_cache_entry *e, const char *name,
+		 const struct stat *st)
+{
+  return (not e->xpm and e->device == st->st_dev and e->inode == st->st_ino
+	  and e->size == st->st_size and e->mtime == st->st_mtime
+#ifndef _WIN32
+	  and e->mtime_ns == st->st_mtim.tv_nsec
+#endif
+	  and strcmp (e->name, name) == 0);
+}
+
+
+extern avt_graphic *
+avt_image_cache_file (const char *filename,
+		      avt_graphic * (*load) (const char *filename))
+{
+  struct stat st;
+  struct avt_cache_entry *e;
+  avt_graphic *image;
+  size_t length;
+
+  if (not filename or not cache.budget or stat (filename, &st) != 0
+      or not S_ISREG (st.st_mode))
+    return load (filename);
+
+  for (e = cache.first; e; e = e->next)
+    if (cache_same_file (e, filename, &st))
+      {
+	cache.hits++;
+	cache_touch (e);
+	return avt_copy_graphic (e->image);
+      }
+
+  cache.misses++;
+
+  // an old version of the same file is no longer needed
+  for (e = cache.first; e; e = e->next)
+    if (not e->xpm and strcmp (e->name, filename) == 0)
+      {
+	cache_remove (e);
+	break;
+      }
+
+  image = load (filename);
+  if (not image)
+    return NULL;
+
+  length = strlen (filename) + 1;
+  e = (struct avt_cache_entry *) malloc (sizeof (*e) + length);
+  if (not e)
+    return image;
+
+  e->bytes = sizeof (*e) + length;
+  e->xpm = NULL;
+  e->device = st.st_dev;
+  e->inode = st.st_ino;
+  e->size = st.st_size;
+  e->mtime = st.st_mtime;
+#ifndef _WIN32
+  e->mtime_ns = st.st_mtim.tv_nsec;
+#else
+  e->mtime_ns = 0;
+#endif
+  memcpy (e->name, filename, length);
+
+  return cache_insert (e, image);
+}
+
+
+// FNV-1a over the header, the colors and the pixels
+// returns false, when the header is invalid
+static bool
+xpm_hash (char **xpm, uint_least32_t * hash)
+{
+  int width, height, colors, lines;
+  uint_least32_t h = 2166136261u;
+
+  if (not xpm[0] or sscanf (xpm[0], "%d %d %d", &width, &height,
+			    &colors) != 3
+      or width <= 0 or height <= 0 or colors <= 0)
+    return false;
+
+  lines = 1 + colors + height;
+
+  for (int l = 0; l < lines; l++)
+    {
+      const unsigned char *c = (const unsigned char *) xpm[l];
+
+      if (not c)
+	return false;
+
+      // the terminating 0 is included, to separate the lines
+      do
+	h = ((h xor *c) * 16777619u) bitand 0xFFFFFFFFu;
+      while (*c++);
+    }
+
+  *hash = h;
+
+  return true;
+}
+
+
+extern avt_graphic *
+avt_image_cache_xpm (char **xpm)
+{
+  struct avt_cache_entry *e;
+  avt_graphic *image;
+  uint_least32_t hash;
+
+  if (not xpm or not cache.budget or not xpm_hash (xpm, &hash))
+    return avt_load_image_xpm (xpm);
+
+  for (e = cache.first; e; e = e->next)
+    if (e->xpm == xpm)
+      {
+	if (e->xpm_hash == hash)
+	  {
+	    cache.hits++;
+	    cache_touch (e);
+	    return avt_copy_graphic (e->image);
+	  }
+
+	// changed or a different array at the same address
+	cache_remove (e);
+	break;
+      }
+
+  cache.misses++;
+
+  image = avt_load_image_xpm (xpm);
+  if (not image)
+    return NULL;
+
+  e = (struct avt_cache_entry *) malloc (sizeof (*e) + 1);
+  if (not e)
+    return image;
+
+  memset (e, 0, sizeof (*e) + 1);
+  e->bytes = sizeof (*e) + 1;
+  e->xpm = xpm;
+  e->xpm_hash = hash;
+
+  return cache_insert (e, image);
+}
+
+
+extern void
+avt_image_cache_forget (const void *data)
+{
+  for (struct avt_cache_entry * e = cache.first; e; e = e->next)
+    if (e->xpm == data)
+      {
+	cache_remove (e);
+	break;
+      }
+}
+
+
+extern void
+avt_image_cache_flush (void)
+{
+  cache_shrink (0);
+}
+
+
+extern void
+avt_set_image_cache (size_t bytes)
+{
+  cache.budget = bytes;
+  cache_shrink (bytes);
+}
+
+
+extern void
+avt_image_cache_statistics (size_t * hits, size_t * misses, size_t * bytes)
+{
+  if (hits)
+    *hits = cache.hits;
+
+  if (misses)
+    *misses = cache.misses;
+
+  if (bytes)
+    *bytes = cache.bytes;
+}
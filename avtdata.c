@@ -31,6 +31,14 @@
 #include <stdint.h>
 #include <string.h>		// memcpy
 #include <iso646.h>
+#include <unistd.h>		// evtl. defines _POSIX_MAPPED_FILES
+
+#if _POSIX_MAPPED_FILES+0 > 0
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#endif
 
 #ifndef __cplusplus
 #include <stdbool.h>
@@ -46,6 +54,16 @@
   (((x)<<24)|(((x)&0xFF00)<<8)|(((x)&0xFF0000)>>8)|((x)>>24))
 #endif
 
+// size of the read ahead buffer for streams
+#define AVT_DATA_BUFFER_SIZE  BUFSIZ
+
+static bool
+method_refill_none (avt_data * d)
+{
+  (void) d;
+  return false;
+}
+
 // reset virtual methods
 static inline void
 reset (avt_data * d)
@@ -56,15 +74,25 @@ reset (avt_data * d)
   d->read16 = NULL;
   d->read32 = NULL;
   d->filenumber = NULL;
+  d->refill = method_refill_none;
+  d->next = d->end = NULL;
 }
 
 static void
 method_done_stream (avt_data * d)
 {
+  // give back what was read ahead, if possible
+  if (not d->priv.stream.autoclose and d->next < d->end)
+    fseek (d->priv.stream.data, -(long) (d->end - d->next), SEEK_CUR);
+
   if (d->priv.stream.autoclose)
     fclose (d->priv.stream.data);
 
+  if (d->priv.stream.buffer)
+    free (d->priv.stream.buffer);
+
   d->priv.stream.data = NULL;
+  d->priv.stream.buffer = NULL;
   d->priv.stream.autoclose = false;
   reset (d);
 }
@@ -73,18 +101,80 @@ method_done_stream (avt_data * d)
 static void
 method_done_memory (avt_data * d)
 {
+#if _POSIX_MAPPED_FILES+0 > 0
+  if (d->priv.memory.mapping)
+    munmap (d->priv.memory.mapping, d->priv.memory.size);
+#endif
+
   d->priv.memory.data = NULL;
-  d->priv.memory.position = 0;
   d->priv.memory.size = 0;
+  d->priv.memory.mapping = NULL;
 
   reset (d);
 }
 
 
+static bool
+method_refill_stream (avt_data * d)
+{
+  size_t size;
+
+  if (d->priv.stream.buffer)
+    {
+      size = fread (d->priv.stream.buffer, 1, AVT_DATA_BUFFER_SIZE,
+		    d->priv.stream.data);
+      d->next = d->priv.stream.buffer;
+    }
+  else				// unbuffered
+    {
+      size = fread (&d->priv.stream.byte, 1, 1, d->priv.stream.data);
+      d->next = &d->priv.stream.byte;
+    }
+
+  d->end = d->next + size;
+
+  return (size > 0);
+}
+
+
+// take as much as possible from the buffer
+static inline size_t
+from_buffer (avt_data * d, void *data, size_t size)
+{
+  size_t available = d->end - d->next;
+
+  if (size > available)
+    size = available;
+
+  if (size)
+    {
+      memcpy (data, d->next, size);
+      d->next += size;
+    }
+
+  return size;
+}
+
+
 static size_t
 method_read_stream (avt_data * d, void *data, size_t size, size_t number)
 {
-  return fread (data, size, number, d->priv.stream.data);
+  size_t all, got;
+
+  all = size * number;
+  got = from_buffer (d, data, all);
+
+  if (got < all)
+    {
+      // big blocks are read directly
+      if (all - got >= AVT_DATA_BUFFER_SIZE or not d->priv.stream.buffer)
+	got += fread ((uint_least8_t *) data + got, 1, all - got,
+		      d->priv.stream.data);
+      else if (method_refill_stream (d))
+	got += from_buffer (d, (uint_least8_t *) data + got, all - got);
+    }
+
+  return size ? got / size : 0;
 }
 
 // skip also works on nonseekable streams
@@ -93,6 +183,8 @@ method_skip_stream (avt_data * d, size_t size)
 {
   char buffer[BUFSIZ];
 
+  size -= from_buffer (d, buffer, size);
+
   while (size > sizeof (buffer))
     {
       fread (buffer, sizeof (buffer), 1, d->priv.stream.data);
@@ -100,40 +192,71 @@ method_skip_stream (avt_data * d, size_t size)
     }
 
   // size <= sizeof(buffer)
-  fread (buffer, 1, size, d->priv.stream.data);
+  if (size)
+    fread (buffer, 1, size, d->priv.stream.data);
 }
 
 static void
 method_skip_memory (avt_data * d, size_t size)
 {
-  d->priv.memory.position += size;
+  if (size > (size_t) (d->end - d->next))
+    size = d->end - d->next;
+
+  d->next += size;
 }
 
 static size_t
 method_read_memory (avt_data * d, void *data, size_t size, size_t number)
 {
-  size_t result = 0;
   size_t all = size * number;
-  size_t position = d->priv.memory.position;
-  size_t datasize = d->priv.memory.size;
+  size_t available = d->end - d->next;
 
   // not all readable?
-  if (position + all > datasize)
+  if (all > available)
     {
       // at least 1 element readable?
-      if (position < datasize and (datasize - position) >= size)
+      if (size and available >= size)
 	{
 	  // integer division ignores the rest
-	  number = (datasize - position) / size;
+	  number = available / size;
 	  all = size * number;
 	}
       else
 	return 0;		// nothing readable
     }
 
-  memcpy (data, d->priv.memory.data + position, all);
-  d->priv.memory.position += all;
-  result = number;
+  memcpy (data, d->next, all);
+  d->next += all;
+
+  return number;
+}
+
+
+extern const void *
+avt_data_direct (avt_data * d, size_t size)
+{
+  const uint_least8_t *result;
+
+  if ((size_t) (d->end - d->next) < size)
+    {
+      // move the rest to the start of the buffer and fill it up
+      if (d->refill != method_refill_stream or not d->priv.stream.buffer
+	  or size > AVT_DATA_BUFFER_SIZE)
+	return NULL;
+
+      size_t rest = d->end - d->next;
+      memmove (d->priv.stream.buffer, d->next, rest);
+      d->next = d->priv.stream.buffer;
+      d->end = d->next + rest
+	+ fread (d->priv.stream.buffer + rest, 1,
+		 AVT_DATA_BUFFER_SIZE - rest, d->priv.stream.data);
+
+      if ((size_t) (d->end - d->next) < size)
+	return NULL;
+    }
+
+  result = d->next;
+  d->next += size;
 
   return result;
 }
@@ -143,11 +266,23 @@ method_read_memory (avt_data * d, void *data, size_t size, size_t number)
 uint_least8_t
 avt_data_read8 (avt_data * d)
 {
-  uint_least8_t data;
+  int c = avt_data_getc (d);
 
-  d->read (d, &data, sizeof (data), 1);
+  return (c != EOF) ? c : 0;
+}
 
-  return data;
+
+// fixed sized values mostly come from the buffer
+static inline void
+read_value (avt_data * d, void *data, size_t size)
+{
+  if ((size_t) (d->end - d->next) >= size)
+    {
+      memcpy (data, d->next, size);
+      d->next += size;
+    }
+  else
+    d->read (d, data, size, 1);
 }
 
 
@@ -157,7 +292,7 @@ method_read16 (avt_data * d)
 {
   uint_least16_t data;
 
-  d->read (d, &data, sizeof (data), 1);
+  read_value (d, &data, sizeof (data));
 
   return data;
 }
@@ -169,7 +304,7 @@ method_read16swap (avt_data * d)
 {
   uint_least16_t data;
 
-  d->read (d, &data, sizeof (data), 1);
+  read_value (d, &data, sizeof (data));
 
   return avt_data_bswap16 (data);
 }
@@ -181,7 +316,7 @@ method_read32 (avt_data * d)
 {
   uint_least32_t data;
 
-  d->read (d, &data, sizeof (data), 1);
+  read_value (d, &data, sizeof (data));
 
   return data;
 }
@@ -193,7 +328,7 @@ method_read32swap (avt_data * d)
 {
   uint_least32_t data;
 
-  d->read (d, &data, sizeof (data), 1);
+  read_value (d, &data, sizeof (data));
 
   return avt_data_bswap32 (data);
 }
@@ -202,23 +337,42 @@ method_read32swap (avt_data * d)
 static long
 method_tell_stream (avt_data * d)
 {
-  return ftell (d->priv.stream.data);
+  long position = ftell (d->priv.stream.data);
+
+  if (position < 0)
+    return -1;
+
+  return position - (long) (d->end - d->next);
 }
 
 
 static long
 method_tell_memory (avt_data * d)
 {
-  if (d->priv.memory.position <= d->priv.memory.size)
-    return d->priv.memory.position;
-  else
-    return -1;
+  return d->next - d->priv.memory.data;
 }
 
 
 static bool
 method_seek_stream (avt_data * d, long offset, int whence)
 {
+  if (SEEK_CUR == whence)
+    {
+      // still in the buffer?
+      if (d->priv.stream.buffer and d->next
+	  and offset >= d->priv.stream.buffer - d->next
+	  and offset <= d->end - d->next)
+	{
+	  d->next += offset;
+	  return true;
+	}
+
+      offset -= d->end - d->next;
+    }
+
+  // forget the buffer
+  d->next = d->end;
+
   return (fseek (d->priv.stream.data, offset, whence) > -1);
 }
 
@@ -226,22 +380,33 @@ method_seek_stream (avt_data * d, long offset, int whence)
 static bool
 method_seek_memory (avt_data * d, long offset, int whence)
 {
+  long position;
+  long size = d->priv.memory.size;
+
   switch (whence)
     {
     case SEEK_SET:
-      d->priv.memory.position = offset;
+      position = offset;
       break;
 
     case SEEK_CUR:
-      d->priv.memory.position += offset;
+      position = (d->next - d->priv.memory.data) + offset;
       break;
 
     case SEEK_END:
-      d->priv.memory.position = d->priv.memory.size - offset;
+      position = size - offset;
       break;
+
+    default:
+      return false;
     }
 
-  return (d->priv.memory.position <= d->priv.memory.size);
+  if (position < 0 or position > size)
+    return false;
+
+  d->next = d->priv.memory.data + position;
+
+  return true;
 }
 
 
@@ -295,8 +460,19 @@ avt_data_open_stream (avt_data * d, FILE * stream, bool autoclose)
   d->seek = method_seek_stream;
   d->filenumber = method_filenumber_stream;
 
+  d->refill = method_refill_stream;
+  d->next = d->end = NULL;
+
   d->priv.stream.data = stream;
   d->priv.stream.autoclose = autoclose;
+  d->priv.stream.buffer = NULL;
+
+  /*
+   * reading ahead from a foreign stream is only okay,
+   * when it can be given back
+   */
+  if (autoclose or ftell (stream) >= 0)
+    d->priv.stream.buffer = malloc (AVT_DATA_BUFFER_SIZE);
 
   return true;
 }
@@ -308,7 +484,45 @@ avt_data_open_file (avt_data * d, const char *filename)
   if (not d or not filename or avt_data_opened (d))
     return false;
 
+#if _POSIX_MAPPED_FILES+0 > 0
+  int fd;
+  struct stat st;
+
+  fd = open (filename, O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  // map regular files, read anything else as stream (pipes, devices)
+  if (fstat (fd, &st) == 0 and S_ISREG (st.st_mode) and st.st_size > 0
+      and (uintmax_t) st.st_size <= SIZE_MAX)
+    {
+      void *mapping;
+
+      mapping = mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+      if (MAP_FAILED != mapping)
+	{
+	  // the mapping stays valid after closing
+	  close (fd);
+	  avt_data_open_memory (d, mapping, st.st_size);
+	  d->priv.memory.mapping = mapping;
+
+	  return true;
+	}
+    }
+
+  FILE *stream = fdopen (fd, "rb");
+
+  if (not stream)
+    {
+      close (fd);
+      return false;
+    }
+
+  return avt_data_open_stream (d, stream, true);
+#else
   return avt_data_open_stream (d, fopen (filename, "rb"), true);
+#endif
 }
 
 
@@ -325,13 +539,46 @@ avt_data_open_memory (avt_data * d, const void *memory, size_t size)
   d->seek = method_seek_memory;
   d->filenumber = method_filenumber_memory;
 
+  d->refill = method_refill_none;
+
   d->priv.memory.data = memory;
-  d->priv.memory.position = 0;
   d->priv.memory.size = size;
+  d->priv.memory.mapping = NULL;
+  d->next = (const uint_least8_t *) memory;
+  d->end = d->next + size;
 
   return true;
 }
 
+extern const void *
+avt_data_memory (avt_data * d, size_t * size)
+{
+  if (not d or d->read != method_read_memory)
+    return NULL;
+
+  if (size)
+    *size = d->end - d->next;
+
+  return d->next;
+}
+
+extern void *
+avt_data_take_mapping (avt_data * d, size_t * length)
+{
+  void *mapping;
+
+  if (not d or d->read != method_read_memory or not d->priv.memory.mapping)
+    return NULL;
+
+  mapping = d->priv.memory.mapping;
+  d->priv.memory.mapping = NULL;
+
+  if (length)
+    *length = d->priv.memory.size;
+
+  return mapping;
+}
+
 extern void
 avt_data_init (avt_data * d)
 {
@@ -339,6 +586,7 @@ avt_data_init (avt_data * d)
     {
       reset (d);
       d->done = method_done_memory;
+      d->priv.memory.mapping = NULL;
     }
 }
 
@@ -348,7 +596,17 @@ avt_data_dup (avt_data * d)
   avt_data *n = malloc (sizeof (*d));
 
   if (n)
-    memcpy (n, d, sizeof (*d));
+    {
+      memcpy (n, d, sizeof (*d));
+
+      // the single byte buffer is part of the structure
+      if (d->next == &d->priv.stream.byte
+	  or d->end == &d->priv.stream.byte + 1)
+	{
+	  n->next = &n->priv.stream.byte + (d->next - &d->priv.stream.byte);
+	  n->end = &n->priv.stream.byte + 1;
+	}
+    }
 
   return n;
 }
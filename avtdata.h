@@ -27,6 +27,7 @@
 
 #include <stdio.h>		// FILE
 #include <stdint.h>
+#include <iso646.h>
 
 #ifndef __cplusplus
 #include <stdbool.h>
@@ -55,6 +56,13 @@ struct avt_data
   uint_least16_t (*read16) (avt_data *);
   uint_least32_t (*read32) (avt_data *);
 
+  // read ahead buffer, for memory it is the data itself
+  // use avt_data_getc(), avt_data_peek() or avt_data_direct()
+  const uint_least8_t *next, *end;
+
+  // fills the buffer, returns false if there is no more data
+  bool (*refill) (avt_data *);
+
 
   // private
   union
@@ -63,12 +71,15 @@ struct avt_data
     {
       FILE *data;
       bool autoclose;
+      uint_least8_t *buffer;	// NULL when unbuffered
+      uint_least8_t byte;	// for unbuffered streams
     } stream;
 
     struct
     {
       const uint_least8_t *data;
-      size_t size, position;
+      size_t size;
+      void *mapping;		// for mapped files
     } memory;
   } priv;
 };
@@ -86,6 +97,7 @@ avt_data *avt_data_dup (avt_data *);
 bool avt_data_open_stream (avt_data *, FILE *, bool autoclose);
 
 // open a file for reading in binary mode
+// regular files are mapped into memory, if possible
 bool avt_data_open_file (avt_data *, const char *);
 
 // read data from memory
@@ -97,6 +109,35 @@ uint_least8_t avt_data_read8 (avt_data *);
 #define avt_data_read16(d) (d)->read16(d)
 #define avt_data_read32(d) (d)->read32(d)
 
+// read the next byte or EOF
+static inline int
+avt_data_getc (avt_data * d)
+{
+  return (d->next < d->end or d->refill (d)) ? *d->next++ : EOF;
+}
+
+// get the next byte or EOF without consuming it
+static inline int
+avt_data_peek (avt_data * d)
+{
+  return (d->next < d->end or d->refill (d)) ? *d->next : EOF;
+}
+
+// get direct access to the next size bytes and consume them
+// returns NULL, if they are not available in one piece
+// then use avt_data_read instead
+const void *avt_data_direct (avt_data *, size_t size);
+
+// get the rest of the data, if it is in memory (also for mapped files)
+// returns NULL otherwise
+const void *avt_data_memory (avt_data *, size_t * size);
+
+// take over the mapping of a mapped file
+// it must be freed with munmap using the returned length
+// the data can still be used until done, but done doesn't unmap it
+// returns NULL, if the data isn't a mapped file
+void *avt_data_take_mapping (avt_data *, size_t * length);
+
 #define avt_data_tell(d) (d)->tell(d)
 #define avt_data_seek(d,offset,whence) (d)->seek((d),(offset),(whence))
 #define avt_data_skip(d,size) (d)->skip((d),(size))
@@ -0,0 +1,330 @@
+/*
+ * writing images in the PPM and PNG formats for AKFAvatar
+ * Copyright (c) 2015
+ * Andreas K. Foerster <akf@akfoerster.de>
+ *
+ * required standards: C99
+ *
+ * This file is part of AKFAvatar
+ *
+ * AKFAvatar is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * AKFAvatar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * The PNG files are not compressed, the image data is stored
+ * in "stored" deflate blocks.  That is very fast to write and
+ * every program can read it.  Use other tools to compress them,
+ * if the size matters.
+ * specification: https://www.w3.org/TR/PNG/ and RFC 1950, 1951
+ */
+
+#include "akfavatar.h"
+#include "avtgraphic.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <iso646.h>
+
+// biggest stored deflate block
+#define PNG_BLOCK_SIZE  65535
+
+static inline void
+png_write32 (uint_least8_t * p, uint_least32_t value)
+{
+  p[0] = value >> 24;
+  p[1] = value >> 16;
+  p[2] = value >> 8;
+  p[3] = value;
+}
+
+
+// writes one pixel line as RGB or RGBA, returns the size
+static size_t
+export_line (uint_least8_t * buffer, const avt_graphic * image, int y,
+	     bool alpha)
+{
+  const avt_color *p;
+  uint_least8_t *b;
+
+  p = avt_pixel ((avt_graphic *) image, 0, y);
+  b = buffer;
+
+  for (int x = image->width; x > 0; x--, p++)
+    {
+      avt_color color = *p;
+
+      if (alpha)
+	{
+	  if (color == image->color_key)
+	    {
+	      *b++ = 0;
+	      *b++ = 0;
+	      *b++ = 0;
+	      *b++ = 0;
+	      continue;
+	    }
+
+	  *b++ = avt_red (color);
+	  *b++ = avt_green (color);
+	  *b++ = avt_blue (color);
+	  *b++ = 255;
+	}
+      else
+	{
+	  *b++ = avt_red (color);
+	  *b++ = avt_green (color);
+	  *b++ = avt_blue (color);
+	}
+    }
+
+  return b - buffer;
+}
+
+
+extern bool
+avt_write_ppm (FILE * f, const avt_graphic * image)
+{
+  uint_least8_t *line;
+  size_t size;
+  bool okay;
+
+  if (not f or not image or not image->pixels)
+    return false;
+
+  line = (uint_least8_t *) malloc (image->width * 3);
+  if (not line)
+    return false;
+
+  okay = (fprintf (f, "P6\n%d %d\n255\n", image->width, image->height) > 0);
+
+  for (int y = 0; okay and y < image->height; y++)
+    {
+      size = export_line (line, image, y, false);
+      okay = (fwrite (line, 1, size, f) == size);
+    }
+
+  free (line);
+
+  return okay;
+}
+
+
+/**********************************************************************/
+// PNG
+
+static uint_least32_t crc_table[256];
+
+static void
+make_crc_table (void)
+{
+  for (uint_least32_t n = 0; n < 256; n++)
+    {
+      uint_least32_t c = n;
+
+      for (int k = 0; k < 8; k++)
+	c = (c bitand 1) ? 0xEDB88320 xor (c >> 1) : (c >> 1);
+
+      crc_table[n] = c;
+    }
+}
+
+// the crc must start with 0xFFFFFFFF and must be inverted at the end
+static inline uint_least32_t
+update_crc (uint_least32_t crc, const uint_least8_t * data, size_t size)
+{
+  while (size--)
+    crc = crc_table[(crc xor *data++) bitand 0xFF] xor (crc >> 8);
+
+  return crc bitand 0xFFFFFFFF;
+}
+
+// the data is split into two parts
+static bool
+png_chunk (FILE * f, const char *type,
+	   const uint_least8_t * data1, size_t size1,
+	   const uint_least8_t * data2, size_t size2)
+{
+  uint_least8_t head[8], tail[4];
+  uint_least32_t crc;
+
+  png_write32 (head, size1 + size2);
+  memcpy (head + 4, type, 4);
+
+  crc = update_crc (0xFFFFFFFF, head + 4, 4);
+  crc = update_crc (crc, data1, size1);
+  crc = update_crc (crc, data2, size2);
+  png_write32 (tail, crc xor 0xFFFFFFFF);
+
+  return (fwrite (head, 1, sizeof (head), f) == sizeof (head)
+	  and fwrite (data1, 1, size1, f) == size1
+	  and fwrite (data2, 1, size2, f) == size2
+	  and fwrite (tail, 1, sizeof (tail), f) == sizeof (tail));
+}
+
+struct png_stream
+{
+  FILE *f;
+  size_t remaining;		// bytes not yet written as block
+  bool first;
+  uint_least32_t adler_a, adler_b;
+  size_t fill;
+  uint_least8_t block[PNG_BLOCK_SIZE];
+};
+
+// writes the filled block as IDAT chunk
+static bool
+png_flush (struct png_stream *s)
+{
+  uint_least8_t head[2 + 5];
+  size_t start;
+
+  start = 0;
+
+  if (s->first)			// zlib header: deflate, 32K window, no dict
+    {
+      head[0] = 0x78;
+      head[1] = 0x01;
+      start = 2;
+      s->first = false;
+    }
+
+  s->remaining -= s->fill;
+
+  // stored block header
+  head[start] = (s->remaining == 0) ? 1 : 0;	// BFINAL
+  head[start + 1] = s->fill bitand 0xFF;
+  head[start + 2] = s->fill >> 8;
+  head[start + 3] = compl s->fill bitand 0xFF;
+  head[start + 4] = (compl s->fill >> 8) bitand 0xFF;
+
+  // Adler-32 of the uncompressed data
+  for (size_t i = 0; i < s->fill;)
+    {
+      // 5552 is the maximum without overflow in 32 bits
+      size_t end = i + 5552;
+
+      if (end > s->fill)
+	end = s->fill;
+
+      for (; i < end; i++)
+	{
+	  s->adler_a += s->block[i];
+	  s->adler_b += s->adler_a;
+	}
+
+      s->adler_a %= 65521;
+      s->adler_b %= 65521;
+    }
+
+  if (not png_chunk (s->f, "IDAT", head, start + 5, s->block, s->fill))
+    return false;
+
+  s->fill = 0;
+
+  return true;
+}
+
+static bool
+png_data (struct png_stream *s, const uint_least8_t * data, size_t size)
+{
+  while (size > 0)
+    {
+      size_t n = PNG_BLOCK_SIZE - s->fill;
+
+      if (n > size)
+	n = size;
+
+      memcpy (s->block + s->fill, data, n);
+      s->fill += n;
+      data += n;
+      size -= n;
+
+      if (s->fill == PNG_BLOCK_SIZE or s->fill == s->remaining)
+	if (not png_flush (s))
+	  return false;
+    }
+
+  return true;
+}
+
+extern bool
+avt_write_png (FILE * f, const avt_graphic * image)
+{
+  static const uint_least8_t signature[8] =
+    { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+  uint_least8_t header[13], adler[4];
+  struct png_stream *s;
+  uint_least8_t *line;
+  size_t line_size;
+  bool alpha, okay;
+
+  if (not f or not image or not image->pixels)
+    return false;
+
+  if (not crc_table[1])
+    make_crc_table ();
+
+  alpha = image->transparent;
+  line_size = 1 + image->width * (alpha ? 4 : 3);
+
+  s = (struct png_stream *) malloc (sizeof (*s));
+  line = (uint_least8_t *) malloc (line_size);
+
+  if (not s or not line)
+    {
+      free (s);
+      free (line);
+      return false;
+    }
+
+  s->f = f;
+  s->remaining = line_size * image->height;
+  s->first = true;
+  s->adler_a = 1;
+  s->adler_b = 0;
+  s->fill = 0;
+
+  png_write32 (header, image->width);
+  png_write32 (header + 4, image->height);
+  header[8] = 8;		// bit depth
+  header[9] = alpha ? 6 : 2;	// RGBA or RGB
+  header[10] = 0;		// deflate
+  header[11] = 0;		// no filters
+  header[12] = 0;		// not interlaced
+
+  okay = (fwrite (signature, 1, sizeof (signature), f) == sizeof (signature)
+	  and png_chunk (f, "IHDR", header, sizeof (header), NULL, 0));
+
+  for (int y = 0; okay and y < image->height; y++)
+    {
+      line[0] = 0;		// filter type none
+      export_line (line + 1, image, y, alpha);
+      okay = png_data (s, line, line_size);
+    }
+
+  if (okay)
+    {
+      png_write32 (adler, (s->adler_b << 16) bitor s->adler_a);
+      okay = (png_chunk (f, "IDAT", adler, sizeof (adler), NULL, 0)
+	      and png_chunk (f, "IEND", NULL, 0, NULL, 0));
+    }
+
+  free (line);
+  free (s);
+
+  return okay;
+}
@@ -30,15 +30,192 @@
 #include <string.h>
 #include <iso646.h>
 
+/*
+ * pool for graphics
+ *
+ * buffers for pixels are recycled in size classes,
+ * powers of two up to POOL_BIG_SIZE, above that four steps per power
+ * of two, so a big buffer wastes at most a quarter of its size;
+ * the avt_graphic headers come from a small arena
+ * this avoids big allocations for temporary graphics,
+ * like in avt_flash or for the backgrounds of buttons
+ */
+
+#define POOL_MIN_SIZE  1024	// smallest size class in bytes
+#define POOL_CLASSES   96
+#define POOL_DEPTH     4	// cached buffers per small class
+#define POOL_BIG_SIZE  (1024 * 1024)	// only 1 buffer cached for bigger
+#define POOL_BIG_CLASS 10	// class with POOL_BIG_SIZE
+#define POOL_HEADERS   64
+
+static struct
+{
+  bool enabled;
+  short int cached[POOL_CLASSES];
+  avt_color *cache[POOL_CLASSES][POOL_DEPTH];
+  short int free_headers;
+  avt_graphic *header_stack[POOL_HEADERS];
+  avt_graphic headers[POOL_HEADERS];
+  size_t avoided;		// allocations avoided
+  size_t bytes;			// bytes for buffers allocated by the pool
+  size_t peak;			// maximum of bytes
+} pool;
+
+static inline size_t
+pool_class_size (int c)
+{
+  if (c <= POOL_BIG_CLASS)
+    return (size_t) POOL_MIN_SIZE << c;
+
+  // 1.25, 1.5, 1.75, 2 times a power of two
+  c -= POOL_BIG_CLASS + 1;
+  return ((size_t) POOL_BIG_SIZE << (c / 4)) / 4 * (5 + c % 4);
+}
+
+static inline int
+pool_class (size_t size)
+{
+  int c = 0;
+
+  while (pool_class_size (c) < size and c < POOL_CLASSES - 1)
+    c++;
+
+  return c;
+}
+
+static inline int
+pool_depth (int c)
+{
+  return (pool_class_size (c) < POOL_BIG_SIZE) ? POOL_DEPTH : 1;
+}
+
+static inline bool
+pool_header (avt_graphic * gr)
+{
+  return (gr >= pool.headers and gr < pool.headers + POOL_HEADERS);
+}
+
+static avt_graphic *
+pool_get_header (void)
+{
+  if (pool.enabled and pool.free_headers > 0)
+    {
+      pool.avoided++;
+      return pool.header_stack[--pool.free_headers];
+    }
+  else
+    return (avt_graphic *) malloc (sizeof (avt_graphic));
+}
+
+static void
+pool_release_header (avt_graphic * gr)
+{
+  if (pool_header (gr))
+    pool.header_stack[pool.free_headers++] = gr;
+  else
+    free (gr);
+}
+
+static avt_color *
+pool_get_pixels (size_t size)
+{
+  int c;
+  avt_color *pixels;
+
+  c = pool_class (size);
+
+  if (pool.cached[c] > 0)
+    {
+      pool.avoided++;
+      return pool.cache[c][--pool.cached[c]];
+    }
+
+  pixels = (avt_color *) malloc (pool_class_size (c));
+
+  if (pixels)
+    {
+      pool.bytes += pool_class_size (c);
+
+      if (pool.bytes > pool.peak)
+	pool.peak = pool.bytes;
+    }
+
+  return pixels;
+}
+
+static void
+pool_release_pixels (avt_color * pixels, size_t size)
+{
+  int c;
+
+  c = pool_class (size);
+
+  if (pool.enabled and pool.cached[c] < pool_depth (c))
+    pool.cache[c][pool.cached[c]++] = pixels;
+  else
+    {
+      free (pixels);
+      pool.bytes -= pool_class_size (c);
+    }
+}
+
+// free all cached buffers
+static void
+pool_flush (void)
+{
+  for (int c = 0; c < POOL_CLASSES; c++)
+    {
+      while (pool.cached[c] > 0)
+	{
+	  free (pool.cache[c][--pool.cached[c]]);
+	  pool.bytes -= pool_class_size (c);
+	}
+    }
+}
+
+extern void
+avt_graphic_pool (bool enable)
+{
+  if (enable and not pool.enabled)
+    {
+      // only headers, which are not in use
+      pool.free_headers = 0;
+      for (int i = POOL_HEADERS - 1; i >= 0; i--)
+	if (not pool.headers[i].pixels)
+	  pool.header_stack[pool.free_headers++] = &pool.headers[i];
+    }
+  else if (not enable)
+    {
+      pool_flush ();
+      pool.free_headers = 0;
+    }
+
+  pool.enabled = enable;
+}
+
+extern void
+avt_graphic_pool_statistics (size_t * avoided, size_t * peak)
+{
+  if (avoided)
+    *avoided = pool.avoided;
+
+  if (peak)
+    *peak = pool.peak;
+}
+
 extern void
 avt_free_graphic (avt_graphic * gr)
 {
   if (gr)
     {
-      if (gr->free_pixels)
+      if (gr->pooled)
+	pool_release_pixels (gr->pixels,
+			     gr->width * gr->height * sizeof (avt_color));
+      else if (gr->free_pixels)
 	free (gr->pixels);
 
-      free (gr);
+      gr->pixels = NULL;
+      pool_release_header (gr);
     }
 }
 
@@ -54,7 +231,7 @@ avt_data_to_graphic (void *data, short width, short height)
 
   // data may be NULL (see avt_new_graphic)
 
-  gr = (avt_graphic *) malloc (sizeof (*gr));
+  gr = pool_get_header ();
 
   if (gr)
     {
@@ -62,6 +239,7 @@ avt_data_to_graphic (void *data, short width, short height)
       gr->height = height;
       gr->transparent = false;
       gr->free_pixels = false;
+      gr->pooled = false;
       gr->color_key = AVT_TRANSPARENT;
       gr->pixels = (avt_color *) data;
     }
@@ -69,6 +247,20 @@ avt_data_to_graphic (void *data, short width, short height)
   return gr;
 }
 
+extern avt_graphic *
+avt_load_image_prebuilt (const struct avt_image *image)
+{
+  avt_graphic *gr;
+
+  gr = avt_data_to_graphic ((void *) image->pixels,
+			    image->width, image->height);
+
+  if (gr and image->transparent)
+    avt_set_color_key (gr, AVT_TRANSPARENT);
+
+  return gr;
+}
+
 extern avt_graphic *
 avt_new_graphic (short width, short height)
 {
@@ -78,10 +270,19 @@ avt_new_graphic (short width, short height)
 
   if (gr)
     {
-      gr->pixels = (avt_color *) malloc (width * height * sizeof (avt_color));
+      size_t size = width * height * sizeof (avt_color);
+
+      if (pool.enabled)
+	{
+	  gr->pixels = pool_get_pixels (size);
+	  gr->pooled = true;
+	}
+      else
+	gr->pixels = (avt_color *) malloc (size);
 
       if (not gr->pixels)
 	{
+	  gr->pooled = false;
 	  avt_free_graphic (gr);
 	  return NULL;
 	}
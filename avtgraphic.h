@@ -43,6 +43,7 @@ typedef struct avt_graphic
   short width, height;
   bool transparent;
   bool free_pixels;
+  bool pooled;
   avt_color color_key;
   avt_color *pixels;
 } avt_graphic;
@@ -51,8 +52,23 @@ avt_graphic *avt_new_graphic (short width, short height);
 
 avt_graphic *avt_data_to_graphic (void *data, short width, short height);
 
+/* prebuilt images, made with xpm2c.awk */
+struct avt_image
+{
+  short width, height;
+  bool transparent;
+  const avt_color *pixels;
+};
+
+/* the pixels are not copied, they must not be changed */
+avt_graphic *avt_load_image_prebuilt (const struct avt_image *image);
+
 void avt_free_graphic (avt_graphic *gr);
 
+// switch the pool for graphics on or off
+// switching it off frees all cached buffers
+void avt_graphic_pool (bool enable);
+
 void avt_bar (avt_graphic *gr, int x, int y, int width, int height, 
               avt_color color);
 
@@ -130,4 +146,25 @@ avt_graphic *avt_load_image_xpm_data (avt_data *src);
 /* avtbmp.c */
 avt_graphic *avt_load_image_bmp_data (avt_data *src);
 
+/* avtqoi.c */
+avt_graphic *avt_load_image_qoi_data (avt_data *src);
+
+/* write image in the QOI format, returns false on errors */
+bool avt_write_qoi (FILE *f, const avt_graphic *image);
+
+/* avtexport.c */
+/* write image in the PPM or PNG format, returns false on errors */
+bool avt_write_ppm (FILE *f, const avt_graphic *image);
+bool avt_write_png (FILE *f, const avt_graphic *image);
+
+/* avtcache.c */
+/* the results are copies, which the caller has to free */
+avt_graphic *avt_image_cache_file (const char *filename,
+                                   avt_graphic *(*load) (const char *filename));
+
+avt_graphic *avt_image_cache_xpm (char **xpm);
+
+/* drop all images */
+void avt_image_cache_flush (void);
+
 #endif
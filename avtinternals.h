@@ -169,8 +169,113 @@ avt_char avt_last_key (void);
 void avt_resize (int width, int height);
 void avt_update_all (void);
 
+// sets the avatar image and frees the given image
+int avt_avatar_image (avt_graphic * image);
+
+// avt_choice with a preselected item and type-ahead keys
+int avt_choice_typed (int *result, int start_line, int items, avt_char key,
+		      bool back, bool forward, int select, avt_char * typed);
+
+// pager for texts in an encoding compatible to ASCII
+int avt_pager_encoded (const char *txt, size_t len, int startline,
+		       const struct avt_charenc *convert);
+
+/* avtthreads.c */
+#define AVT_MAX_THREADS 16
+
+// returns the number of threads actually available (including the caller)
+int avt_start_threads (int threads);
+void avt_quit_threads (void);
+
+// calls band for horizontal bands of the area, maybe in parallel
+void avt_bands (void (*band) (void *data, int y, int height), void *data,
+		int y, int width, int height);
+
+/* avtscale.c */
+struct avt_fb_color
+{
+  int offset, length;		// bits
+};
+
+// framebuffer in memory
+struct avt_fb
+{
+  uint_least8_t *pixels;
+  int width, height;
+  size_t line_length;		// bytes per line
+  int bytes_per_pixel;
+  struct avt_fb_color red, green, blue;
+  void (*pack_row) (const struct avt_fb * fb, void *dest,
+		    const avt_color * pixels, int count);
+
+  // scaling of the logical screen, xmap is NULL when not scaled
+  struct
+  {
+    bool smooth;		// bilinear filter, else nearest neighbor
+    int x, y, width, height;	// area in the framebuffer
+    int *xmap, *ymap;		// source pixel for each destination pixel
+    uint_least16_t *xfrac, *yfrac;	// weight of the next source pixel
+    int *first_x, *first_y;	// first destination pixel for source pixel
+  } scale;
+};
+
+// sets bytes_per_pixel and pack_row, false if the format is unsupported
+bool avt_fb_format (struct avt_fb *fb, int bits_per_pixel);
+
+/*
+ * mode is like FRAMEBUFFER_SCALE: "auto", "minimal" or a factor
+ * width and height get the logical size of the screen
+ * returns false, when not scaled
+ */
+bool avt_fb_scale (struct avt_fb *fb, const char *mode, bool smooth,
+		   int *width, int *height);
+void avt_fb_unscale (struct avt_fb *fb);
+
+// the area must be inside of the screen
+void avt_fb_update (struct avt_fb *fb, avt_graphic * screen, int x, int y,
+		    int width, int height);
+
 /* avttiming.c */
 void avt_delay (int milliseconds);	// only for under a second
+void avt_delay_until (uint_least64_t deadline);	// no events handled
+uint_least64_t avt_clock_ns (void);	// real time, not from the start
+void avt_virtual_time (bool on);	// time only advances by sleeping
+
+/* avtstats.c */
+#ifdef AVT_NO_STATS
+#  define avt_count(nr, n)  ((void) 0)
+#  define avt_stat_clock()  ((uint_least64_t) 0)
+#  define avt_count_update(width, height, start)  ((void) (start))
+#else
+extern uint_least64_t avt_stats[AVT_STAT_COUNT];
+
+// relaxed, because the audio callback runs in its own thread
+#  ifdef __GNUC__
+#    define avt_count(nr, n)  \
+       ((void) __atomic_fetch_add (&avt_stats[nr], (n), __ATOMIC_RELAXED))
+#  else
+#    define avt_count(nr, n)  ((void) (avt_stats[nr] += (n)))
+#  endif
+
+#  define avt_stat_clock()  avt_clock_ns ()
+
+// for the backends, start is from avt_stat_clock before the update
+void avt_count_update (int width, int height, uint_least64_t start);
+#endif
+
+/* avttrace.c */
+#if defined (__GNUC__) and not defined (AVT_NO_STATS)
+#  define AVT_TRACE 1
+
+// a complete event, which started at start (from avt_clock_ns)
+void avt_trace_complete (const char *name, uint_least64_t start);
+
+// names the calling thread, if it has no name yet
+void avt_trace_thread (const char *name);
+#else
+#  define avt_trace_complete(name, start)  ((void) 0)
+#  define avt_trace_thread(name)  ((void) 0)
+#endif
 
 /* audio-sdl.c */
 void avt_lock_audio (void);
@@ -179,6 +284,16 @@ void avt_unlock_audio (avt_audio * snd);
 /* audio-common */
 int avt_start_audio_common (void (*quit_backend) (void));
 
+/* avatar-headless.c */
+// number of updates since the last call and their bounding box
+size_t avt_headless_damage (int *x, int *y, int *width, int *height);
+
+// checksum of the shown screen, for regression tests
+uint_least32_t avt_headless_checksum (void);
+
+// keys fed one at a time, when a key is awaited, ended with AVT_KEY_NONE
+void avt_headless_keys (const avt_char * keys);
+
 /* avtposix.c / avtwindows.c */
 /* currently not used */
 void get_user_home (char *home_dir, size_t size);
@@ -28,6 +28,9 @@
 
 #define SCROLL_DELAY 10
 
+// a pause in typing starts a new search
+#define TYPE_AHEAD_DELAY 1000
+
 // three arrows up
 #define BACK L"\u2191    \u2191    \u2191"
 
@@ -43,9 +46,9 @@
            avt_set_text_background_ballooncolor(); \
          } while(0)
 
-extern int
-avt_menu (int *choice, int items,
-	  void (*show) (int nr, void *data), void *data)
+static int
+menu (int *choice, int items, void (*show) (int nr, void *data),
+      int (*search) (const wchar_t * prefix, void *data), void *data)
 {
   // check required parameters
   if (items <= 0 or not show)
@@ -82,6 +85,12 @@ avt_menu (int *choice, int items,
   enum
   { MOVE_NONE, MOVE_UP, MOVE_DOWN } move = MOVE_NONE;
 
+  // type-ahead
+  wchar_t prefix[AVT_LINELENGTH + 1];
+  size_t prefix_length = 0;
+  size_t last_typed = 0;
+  int select = 0;
+
   bool old_auto_margin = avt_get_auto_margin ();
   avt_set_auto_margin (false);
 
@@ -212,12 +221,51 @@ avt_menu (int *choice, int items,
 	}
 
       int page_choice;		// choice for this page
-      if (avt_choice (&page_choice, start_line, page_items, AVT_KEY_NONE,
-		      page_nr > 0,
-		      not small and (page_items == max_idx or page_nr == 0)))
+      avt_char typed = AVT_KEY_NONE;
+      if (avt_choice_typed (&page_choice, start_line, page_items,
+			    AVT_KEY_NONE, page_nr > 0,
+			    not small and (page_items == max_idx
+					   or page_nr == 0),
+			    select, search ? &typed : NULL))
 	break;
 
-      if (page_nr > 0 and page_choice == 1)
+      select = 0;
+
+      if (typed)
+	{
+	  if (avt_elapsed (last_typed) > TYPE_AHEAD_DELAY)
+	    prefix_length = 0;
+
+	  last_typed = avt_ticks ();
+
+	  if (prefix_length < AVT_LINELENGTH)
+	    {
+	      prefix[prefix_length++] = (wchar_t) typed;
+	      prefix[prefix_length] = L'\0';
+	    }
+
+	  int found = search (prefix, data);
+
+	  if (found > 0 and found <= items)
+	    {
+	      // page 0 has one more item, because there is no back-mark
+	      if (small or found <= items_per_page + 1)
+		page_nr = 0;
+	      else
+		page_nr = (found - 2) / items_per_page;
+
+	      // line on the page
+	      if (page_nr == 0)
+		select = found;
+	      else
+		select = found - (page_nr * items_per_page);
+	    }
+	  else
+	    avt_bell ();
+
+	  move = MOVE_NONE;
+	}
+      else if (page_nr > 0 and page_choice == 1)
 	{
 	  page_nr--;		// page back
 	  move = MOVE_DOWN;
@@ -240,3 +288,19 @@ avt_menu (int *choice, int items,
 
   return _avt_STATUS;
 }
+
+extern int
+avt_menu (int *choice, int items,
+	  void (*show) (int nr, void *data), void *data)
+{
+  return menu (choice, items, show, NULL, data);
+}
+
+extern int
+avt_menu_search (int *choice, int items,
+		 void (*show) (int nr, void *data),
+		 int (*search) (const wchar_t * prefix, void *data),
+		 void *data)
+{
+  return menu (choice, items, show, search, data);
+}
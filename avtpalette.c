@@ -24,11 +24,153 @@
 #include "avtinternals.h"
 #include "rgb.h"
 #include <stdlib.h>
-#include <strings.h>		// strcasecmp
+#include <string.h>
+#include <ctype.h>
 #include <iso646.h>
 
 #define avt_isblank(c)  ((c) == ' ' or (c) == '\t')
 
+// longest name in the table plus some reserve
+#define MAX_NAME_LENGTH 64
+
+// X11 style "rgb:r/g/b" with 1 to 4 hex digits per value
+static int
+rgb_value (const char *s)
+{
+  int rgb[3];
+
+  for (int i = 0; i < 3; i++)
+    {
+      long int value;
+      int digits;
+
+      if (i > 0)
+	{
+	  if (*s != '/')
+	    return -1;
+	  s++;
+	}
+
+      // strtol would also take a sign, spaces or "0x"
+      for (digits = 0; isxdigit ((unsigned char) s[digits]); digits++)
+	if (digits >= 4)
+	  return -1;
+
+      if (digits < 1)
+	return -1;
+
+      value = strtol (s, NULL, 16);
+
+      // scale to 8 bits
+      rgb[i] = (value * 255 + ((1L << (4 * digits)) - 1) / 2)
+	/ ((1L << (4 * digits)) - 1);
+
+      s += digits;
+    }
+
+  return avt_rgb (rgb[0], rgb[1], rgb[2]);
+}
+
+// "%h,s,v" with hue in degrees, saturation and value in percent
+static int
+hsv_value (const char *s)
+{
+  long int hsv[3];
+  long int v, p, q, t, rest;
+
+  for (int i = 0; i < 3; i++)
+    {
+      char *end;
+
+      if (i > 0)
+	{
+	  if (*s != ',' and *s != '/' and not avt_isblank (*s))
+	    return -1;
+
+	  while (*s == ',' or *s == '/' or avt_isblank (*s))
+	    s++;
+	}
+
+      hsv[i] = strtol (s, &end, 10);
+
+      if (end == s)
+	return -1;
+
+      s = end;
+    }
+
+  if (hsv[0] < 0 or hsv[0] > 360 or hsv[1] < 0 or hsv[1] > 100
+      or hsv[2] < 0 or hsv[2] > 100)
+    return -1;
+
+  v = hsv[2] * 255 / 100;
+  rest = hsv[0] % 60;
+  p = v * (100 - hsv[1]) / 100;
+  q = v * (6000 - hsv[1] * rest) / 6000;
+  t = v * (6000 - hsv[1] * (60 - rest)) / 6000;
+
+  switch ((hsv[0] / 60) % 6)
+    {
+    case 0:
+      return avt_rgb (v, t, p);
+    case 1:
+      return avt_rgb (q, v, p);
+    case 2:
+      return avt_rgb (p, v, t);
+    case 3:
+      return avt_rgb (p, q, v);
+    case 4:
+      return avt_rgb (t, p, v);
+    default:
+      return avt_rgb (v, p, q);
+    }
+}
+
+// binary search for the name in lower case without spaces
+static int
+table_value (const char *name)
+{
+  char key[MAX_NAME_LENGTH + 1];
+  size_t length;
+  int low, high;
+
+  length = 0;
+
+  for (; *name; name++)
+    {
+      if (avt_isblank (*name))
+	continue;
+
+      if (length >= MAX_NAME_LENGTH)
+	return -1;
+
+      if (*name >= 'A' and * name <= 'Z')
+	key[length++] = *name - 'A' + 'a';
+      else
+	key[length++] = *name;
+    }
+
+  key[length] = '\0';
+
+  low = 0;
+  high = sizeof (avt_colors_sorted) / sizeof (avt_colors_sorted[0]);
+
+  while (low < high)
+    {
+      int middle = low + (high - low) / 2;
+      int c = strcmp (avt_colors_sorted[middle].key, key);
+
+      if (c == 0)
+	return avt_colors_sorted[middle].number;
+      else if (c < 0)
+	low = middle + 1;
+      else
+	high = middle;
+    }
+
+  return -1;
+}
+
 extern size_t
 avt_palette_size (void)
 {
@@ -67,17 +209,12 @@ avt_colorname (const char *name)
 	  colornr = avt_rgb ((r << 4 | r), (g << 4 | g), (b << 4 | b));
 	}
     }
-  else if (name[0] == '%')	// HSV values not supported
-    colornr = -1;
+  else if (name[0] == '%')	// HSV values
+    colornr = hsv_value (name + 1);
+  else if (strncmp (name, "rgb:", 4) == 0)
+    colornr = rgb_value (name + 4);
   else				// look up color table
-    {
-      int i;
-      const int numcolors = sizeof (avt_colors) / sizeof (avt_colors[0]);
-
-      for (i = 0; i < numcolors and colornr == -1; i++)
-	if (strcasecmp (avt_colors[i].name, name) == 0)
-	  colornr = avt_colors[i].number;
-    }
+    colornr = table_value (name);
 
   return colornr;
 }
@@ -0,0 +1,354 @@
+/*
+ * QOI (Quite OK Image format) support for AKFAvatar
+ * Copyright (c) 2015
+ * Andreas K. Foerster <akf@akfoerster.de>
+ *
+ * required standards: C99
+ *
+ * This file is part of AKFAvatar
+ *
+ * AKFAvatar is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * AKFAvatar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * specification: https://qoiformat.org/qoi-specification.pdf
+ * the alpha channel is reduced to the color key:
+ * pixels with an alpha value below 128 are transparent
+ */
+
+#include "akfavatar.h"
+#include "avtgraphic.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <iso646.h>
+
+#define QOI_OP_INDEX  0x00	// 00xxxxxx
+#define QOI_OP_DIFF   0x40	// 01xxxxxx
+#define QOI_OP_LUMA   0x80	// 10xxxxxx
+#define QOI_OP_RUN    0xC0	// 11xxxxxx
+#define QOI_OP_RGB    0xFE
+#define QOI_OP_RGBA   0xFF
+#define QOI_MASK      0xC0
+
+#define QOI_HEADER_SIZE  14
+
+// biggest size of one encoded pixel
+#define QOI_MAX_CHUNK  5
+
+struct qoi_pixel
+{
+  uint_least8_t r, g, b, a;
+};
+
+static inline unsigned int
+qoi_hash (struct qoi_pixel p)
+{
+  return (p.r * 3 + p.g * 5 + p.b * 7 + p.a * 11) % 64;
+}
+
+static inline bool
+qoi_equal (struct qoi_pixel p1, struct qoi_pixel p2)
+{
+  return (p1.r == p2.r and p1.g == p2.g and p1.b == p2.b and p1.a == p2.a);
+}
+
+static inline uint_least32_t
+qoi_read32 (const uint_least8_t * p)
+{
+  return ((uint_least32_t) p[0] << 24) bitor ((uint_least32_t) p[1] << 16)
+    bitor ((uint_least32_t) p[2] << 8) bitor p[3];
+}
+
+static inline void
+qoi_write32 (uint_least8_t * p, uint_least32_t value)
+{
+  p[0] = value >> 24;
+  p[1] = value >> 16;
+  p[2] = value >> 8;
+  p[3] = value;
+}
+
+extern avt_graphic *
+avt_load_image_qoi_data (avt_data * src)
+{
+  avt_graphic *image;
+  long start;
+  uint_least8_t header[QOI_HEADER_SIZE];
+  uint_least32_t width, height;
+  struct qoi_pixel index[64];
+  struct qoi_pixel px;
+  avt_color color;
+  avt_color *pixels;
+  size_t count;
+  int run;
+
+  if (not src)
+    return NULL;
+
+  image = NULL;
+  start = avt_data_tell (src);
+
+  if (avt_data_read (src, header, sizeof (header), 1) < 1
+      or memcmp (header, "qoif", 4) != 0)
+    goto done;
+
+  width = qoi_read32 (header + 4);
+  height = qoi_read32 (header + 8);
+
+  // channels (3 or 4) and colorspace are not needed
+  if (width < 1 or width > 0x7FFF or height < 1 or height > 0x7FFF)
+    goto done;
+
+  image = avt_new_graphic (width, height);
+  if (not image)
+    goto done;
+
+  memset (index, 0, sizeof (index));
+  px.r = px.g = px.b = 0;
+  px.a = 255;
+  color = 0;
+  run = 0;
+
+  pixels = image->pixels;
+  count = (size_t) width * height;
+
+  for (size_t i = 0; i < count; i++)
+    {
+      if (run > 0)
+	run--;
+      else
+	{
+	  int b1 = avt_data_getc (src);
+
+	  if (b1 == EOF)
+	    {
+	      // premature end: fill the rest with the last color
+	      while (i < count)
+		pixels[i++] = color;
+	      break;
+	    }
+
+	  if (b1 == QOI_OP_RGB)
+	    {
+	      px.r = avt_data_getc (src);
+	      px.g = avt_data_getc (src);
+	      px.b = avt_data_getc (src);
+	    }
+	  else if (b1 == QOI_OP_RGBA)
+	    {
+	      px.r = avt_data_getc (src);
+	      px.g = avt_data_getc (src);
+	      px.b = avt_data_getc (src);
+	      px.a = avt_data_getc (src);
+	    }
+	  else
+	    switch (b1 bitand QOI_MASK)
+	      {
+	      case QOI_OP_INDEX:
+		px = index[b1];
+		break;
+
+	      case QOI_OP_DIFF:
+		px.r += ((b1 >> 4) bitand 3) - 2;
+		px.g += ((b1 >> 2) bitand 3) - 2;
+		px.b += (b1 bitand 3) - 2;
+		break;
+
+	      case QOI_OP_LUMA:
+		{
+		  int b2 = avt_data_getc (src);
+		  int vg = (b1 bitand 0x3F) - 32;
+
+		  px.r += vg - 8 + ((b2 >> 4) bitand 0x0F);
+		  px.g += vg;
+		  px.b += vg - 8 + (b2 bitand 0x0F);
+		}
+		break;
+
+	      case QOI_OP_RUN:
+		run = b1 bitand 0x3F;
+		break;
+	      }
+
+	  index[qoi_hash (px)] = px;
+
+	  if (px.a < 128)
+	    {
+	      color = AVT_TRANSPARENT;
+	      avt_set_color_key (image, AVT_TRANSPARENT);
+	    }
+	  else
+	    color = avt_rgb (px.r, px.g, px.b);
+	}
+
+      pixels[i] = color;
+    }
+
+  // skip the end marker (7 times 0x00, 0x01)
+  avt_data_skip (src, 8);
+
+done:
+  if (not image)
+    avt_data_seek (src, start, SEEK_SET);
+
+  return image;
+}
+
+extern bool
+avt_write_qoi (FILE * f, const avt_graphic * image)
+{
+  uint_least8_t buffer[64 * 1024];
+  size_t pos;
+  struct qoi_pixel index[64];
+  struct qoi_pixel px, previous;
+  const avt_color *pixels;
+  size_t count;
+  int run;
+
+  if (not f or not image or not image->pixels)
+    return false;
+
+  memcpy (buffer, "qoif", 4);
+  qoi_write32 (buffer + 4, image->width);
+  qoi_write32 (buffer + 8, image->height);
+  buffer[12] = image->transparent ? 4 : 3;	// channels
+  buffer[13] = 0;		// sRGB with linear alpha
+  pos = QOI_HEADER_SIZE;
+
+  memset (index, 0, sizeof (index));
+  previous.r = previous.g = previous.b = 0;
+  previous.a = 255;
+  run = 0;
+
+  pixels = image->pixels;
+  count = (size_t) image->width * image->height;
+
+  for (size_t i = 0; i < count; i++)
+    {
+      avt_color color = pixels[i];
+
+      if (image->transparent and color == image->color_key)
+	{
+	  px.r = px.g = px.b = 0;
+	  px.a = 0;
+	}
+      else
+	{
+	  px.r = avt_red (color);
+	  px.g = avt_green (color);
+	  px.b = avt_blue (color);
+	  px.a = 255;
+	}
+
+      if (qoi_equal (px, previous))
+	{
+	  run++;
+
+	  if (run == 62 or i == count - 1)
+	    {
+	      buffer[pos++] = QOI_OP_RUN bitor (run - 1);
+	      run = 0;
+	    }
+	}
+      else
+	{
+	  unsigned int h;
+
+	  if (run > 0)
+	    {
+	      buffer[pos++] = QOI_OP_RUN bitor (run - 1);
+	      run = 0;
+	    }
+
+	  h = qoi_hash (px);
+
+	  if (qoi_equal (index[h], px))
+	    buffer[pos++] = QOI_OP_INDEX bitor h;
+	  else
+	    {
+	      index[h] = px;
+
+	      if (px.a == previous.a)
+		{
+		  int vr = px.r - previous.r;
+		  int vg = px.g - previous.g;
+		  int vb = px.b - previous.b;
+		  int vg_r, vg_b;
+
+		  // differences wrap around
+		  vr = (int8_t) vr;
+		  vg = (int8_t) vg;
+		  vb = (int8_t) vb;
+		  vg_r = vr - vg;
+		  vg_b = vb - vg;
+
+		  if (vr > -3 and vr < 2 and vg > -3 and vg < 2
+		      and vb > -3 and vb < 2)
+		    buffer[pos++] = QOI_OP_DIFF bitor ((vr + 2) << 4)
+		      bitor ((vg + 2) << 2) bitor (vb + 2);
+		  else if (vg_r > -9 and vg_r < 8 and vg > -33 and vg < 32
+			   and vg_b > -9 and vg_b < 8)
+		    {
+		      buffer[pos++] = QOI_OP_LUMA bitor (vg + 32);
+		      buffer[pos++] = ((vg_r + 8) << 4) bitor (vg_b + 8);
+		    }
+		  else
+		    {
+		      buffer[pos++] = QOI_OP_RGB;
+		      buffer[pos++] = px.r;
+		      buffer[pos++] = px.g;
+		      buffer[pos++] = px.b;
+		    }
+		}
+	      else
+		{
+		  buffer[pos++] = QOI_OP_RGBA;
+		  buffer[pos++] = px.r;
+		  buffer[pos++] = px.g;
+		  buffer[pos++] = px.b;
+		  buffer[pos++] = px.a;
+		}
+	    }
+	}
+
+      previous = px;
+
+      if (pos > sizeof (buffer) - QOI_MAX_CHUNK)
+	{
+	  if (fwrite (buffer, 1, pos, f) != pos)
+	    return false;
+
+	  pos = 0;
+	}
+    }
+
+  // end marker
+  if (pos > sizeof (buffer) - 8)
+    {
+      if (fwrite (buffer, 1, pos, f) != pos)
+	return false;
+
+      pos = 0;
+    }
+
+  memset (buffer + pos, 0, 7);
+  buffer[pos + 7] = 0x01;
+  pos += 8;
+
+  return (fwrite (buffer, 1, pos, f) == pos);
+}
@@ -25,13 +25,35 @@
 #include "avtaddons.h"
 #include <stdio.h>
 #include <iso646.h>
+#include <limits.h>
+#include <unistd.h>		/* evtl. defines _POSIX_MAPPED_FILES */
+#include <sys/types.h>
+#include <sys/stat.h>
 
+#if _POSIX_MAPPED_FILES+0 > 0
+#include <stdint.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#endif
+
+/* first allocation for streams with unknown size */
+#define READ_CHUNK  65536
+
+/* the result must fit into an int, including the terminator */
+#define READ_MAX  (INT_MAX - 4)
+
+/*
+ * for regular files the buffer is allocated once with the size
+ * of the file, plus one byte to detect the end without growing;
+ * pipes grow geometrically
+ */
 static int
 read_stream (FILE * f, char **buffer, bool terminate)
 {
   char *buf;
   int size, capacity;
   ssize_t nread;
+  struct stat st;
 
   *buffer = buf = NULL;
   nread = 0;
@@ -46,7 +68,19 @@ read_stream (FILE * f, char **buffer, bool terminate)
 	{
 	  char *nbuf;
 
-	  capacity += 10240;
+	  if (capacity >= READ_MAX)
+	    break;		/* too big */
+	  else if (not capacity and fstat (fileno (f), &st) == 0
+		   and S_ISREG (st.st_mode) and st.st_size > 0
+		   and st.st_size < READ_MAX)
+	    capacity = st.st_size + 1;
+	  else if (not capacity)
+	    capacity = READ_CHUNK;
+	  else if (capacity < READ_MAX / 2)
+	    capacity *= 2;
+	  else
+	    capacity = READ_MAX;
+
 	  if (terminate)
 	    nbuf = (char *) realloc (buf, capacity + 4);
 	  else
@@ -173,12 +207,56 @@ avt_read_command (const char *command, char **buffer)
   return size;
 }
 
+#if _POSIX_MAPPED_FILES+0 > 0
+
+/*
+ * regular files are mapped into memory,
+ * the pager then only reads, what it shows
+ * returns false, if the file cannot be mapped
+ */
+static bool
+pager_mapped_file (const char *file_name, int startline)
+{
+  int fd;
+  struct stat st;
+  void *mapping;
+
+  fd = open (file_name, O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  if (fstat (fd, &st) != 0 or not S_ISREG (st.st_mode)
+      or st.st_size <= 0 or (uintmax_t) st.st_size > SIZE_MAX)
+    {
+      close (fd);
+      return false;
+    }
+
+  mapping = mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close (fd);
+
+  if (mapping == MAP_FAILED)
+    return false;
+
+  avt_pager_char ((const char *) mapping, st.st_size, startline);
+  munmap (mapping, st.st_size);
+
+  return true;
+}
+
+#endif /* _POSIX_MAPPED_FILES */
+
 extern int
 avt_pager_file (const char *file_name, int startline)
 {
   char *txt;
   int len;
 
+#if _POSIX_MAPPED_FILES+0 > 0
+  if (file_name and pager_mapped_file (file_name, startline))
+    return 0;			/* okay */
+#endif
+
   txt = NULL;
   len = avt_read_datafile (file_name, (void **) &txt);
 
@@ -0,0 +1,412 @@
+/*
+ * scaling and converting the screen for framebuffers
+ * Copyright (c) 2015 Andreas K. Foerster <akf@akfoerster.de>
+ *
+ * required standards: C99
+ *
+ * This file is part of AKFAvatar
+ *
+ * AKFAvatar is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * AKFAvatar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * The screen is converted into the pixel format of a framebuffer
+ * in memory.  It can be rendered at a lower logical resolution and
+ * scaled up, with the nearest neighbor or a bilinear filter.
+ * It is used by the Linux framebuffer backend and by avtbench.
+ */
+
+#include "akfavatar.h"
+#include "avtinternals.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <iso646.h>
+
+// pixels converted at once for a scaled line
+#define SCALE_CHUNK  512
+
+// horizontal part of the area to update, the lines are given to the bands
+struct fb_area
+{
+  struct avt_fb *fb;
+  avt_graphic *screen;
+  int x, width;
+};
+
+static void
+pack_32bit (const struct avt_fb *fb, void *dest, const avt_color * pixels,
+	    int count)
+{
+  uint_least32_t *p = (uint_least32_t *) dest;
+
+  // in this mode it might be superfluous to repack pixels,
+  // but I want to play save
+  for (int i = 0; i < count; i++)
+    {
+      register avt_color color = pixels[i];
+
+      p[i] = (avt_red (color) << fb->red.offset)
+	bitor (avt_green (color) << fb->green.offset)
+	bitor (avt_blue (color) << fb->blue.offset);
+    }
+}
+
+static void
+pack_24bit (const struct avt_fb *fb, void *dest, const avt_color * pixels,
+	    int count)
+{
+  uint_least8_t *p = (uint_least8_t *) dest;
+
+  (void) fb;
+
+  for (int i = 0; i < count; i++)
+    {
+      register avt_color color = pixels[i];
+
+      if (AVT_BIG_ENDIAN == AVT_BYTE_ORDER)
+	{
+	  *p++ = avt_red (color);
+	  *p++ = avt_green (color);
+	  *p++ = avt_blue (color);
+	}
+      else			// little endian
+	{
+	  *p++ = avt_blue (color);
+	  *p++ = avt_green (color);
+	  *p++ = avt_red (color);
+	}
+    }
+}
+
+static void
+pack_16bit (const struct avt_fb *fb, void *dest, const avt_color * pixels,
+	    int count)
+{
+  uint_least16_t *p = (uint_least16_t *) dest;
+
+  for (int i = 0; i < count; i++)
+    {
+      register avt_color color = pixels[i];
+
+      p[i] = ((avt_red (color) >> (8 - fb->red.length)))
+	<< fb->red.offset
+	bitor (avt_green (color) >> (8 - fb->green.length))
+	<< fb->green.offset
+	bitor (avt_blue (color) >> (8 - fb->blue.length))
+	<< fb->blue.offset;
+    }
+}
+
+extern bool
+avt_fb_format (struct avt_fb *fb, int bits_per_pixel)
+{
+  switch (bits_per_pixel)
+    {
+    case 32:
+      fb->pack_row = pack_32bit;
+      break;
+
+    case 24:
+      fb->pack_row = pack_24bit;
+      break;
+
+    case 16:
+    case 15:
+      fb->pack_row = pack_16bit;
+      break;
+
+    default:
+      fb->pack_row = NULL;
+      return false;
+    }
+
+  fb->bytes_per_pixel = (bits_per_pixel + 7) / 8;
+
+  return true;
+}
+
+// unscaled screen
+static void
+band_direct (void *data, int y, int height)
+{
+  struct fb_area *area = (struct fb_area *) data;
+  struct avt_fb *fb = area->fb;
+  avt_graphic *screen = area->screen;
+  avt_color *pixels = screen->pixels + (y * screen->width) + area->x;
+  uint_least8_t *fbp =
+    fb->pixels + y * fb->line_length + area->x * fb->bytes_per_pixel;
+
+  for (int ly = 0; ly < height; ly++)
+    {
+      fb->pack_row (fb, fbp, pixels, area->width);
+      fbp += fb->line_length;
+      pixels += screen->width;
+    }
+}
+
+static inline avt_color
+blend (avt_color a, avt_color b, unsigned int weight)
+{
+  // red and blue are computed together
+  uint_least32_t rb, g;
+
+  rb = ((a bitand 0xFF00FFu) * (256u - weight)
+	+ (b bitand 0xFF00FFu) * weight) >> 8;
+  g = ((a bitand 0x00FF00u) * (256u - weight)
+       + (b bitand 0x00FF00u) * weight) >> 8;
+
+  return (rb bitand 0xFF00FFu) bitor (g bitand 0x00FF00u);
+}
+
+static void
+scale_nearest (const struct avt_fb *fb, avt_color * line,
+	       const avt_graphic * screen, int x, int y, int count)
+{
+  const avt_color *source = screen->pixels + fb->scale.ymap[y] * screen->width;
+  const int *xmap = fb->scale.xmap + x;
+
+  for (int i = 0; i < count; i++)
+    line[i] = source[xmap[i]];
+}
+
+static void
+scale_smooth (const struct avt_fb *fb, avt_color * line,
+	      const avt_graphic * screen, int x, int y, int count)
+{
+  const avt_color *line0 = screen->pixels + fb->scale.ymap[y] * screen->width;
+  const avt_color *line1 = line0 + screen->width;
+  const int *xmap = fb->scale.xmap + x;
+  const uint_least16_t *xfrac = fb->scale.xfrac + x;
+  unsigned int yfrac = fb->scale.yfrac[y];
+
+  // the maps never point to the last pixel of a line or column
+  for (int i = 0; i < count; i++)
+    {
+      int sx = xmap[i];
+
+      line[i] = blend (blend (line0[sx], line0[sx + 1], xfrac[i]),
+		       blend (line1[sx], line1[sx + 1], xfrac[i]), yfrac);
+    }
+}
+
+// scaled screen, y and height are lines of the scaled area
+static void
+band_scaled (void *data, int y, int height)
+{
+  struct fb_area *area = (struct fb_area *) data;
+  struct avt_fb *fb = area->fb;
+  avt_graphic *screen = area->screen;
+  avt_color line[SCALE_CHUNK];
+  uint_least32_t packed[SCALE_CHUNK];	// enough for 32 bit
+  uint_least8_t *fbp = fb->pixels + (fb->scale.y + y) * fb->line_length
+    + (fb->scale.x + area->x) * fb->bytes_per_pixel;
+  int end = y + height;
+
+  while (y < end)
+    {
+      int lines = 1;
+
+      // lines from the same source line are only computed once
+      if (not fb->scale.smooth)
+	while (y + lines < end
+	       and fb->scale.ymap[y + lines] == fb->scale.ymap[y])
+	  lines++;
+
+      for (int x = 0; x < area->width; x += SCALE_CHUNK)
+	{
+	  int count = avt_min (SCALE_CHUNK, area->width - x);
+	  size_t size = count * fb->bytes_per_pixel;
+	  uint_least8_t *p = fbp + x * fb->bytes_per_pixel;
+
+	  if (fb->scale.smooth)
+	    scale_smooth (fb, line, screen, area->x + x, y, count);
+	  else
+	    scale_nearest (fb, line, screen, area->x + x, y, count);
+
+	  fb->pack_row (fb, packed, line, count);
+
+	  // don't read from the framebuffer, it might be slow
+	  for (int l = 0; l < lines; l++, p += fb->line_length)
+	    memcpy (p, packed, size);
+	}
+
+      y += lines;
+      fbp += lines * fb->line_length;
+    }
+}
+
+extern void
+avt_fb_update (struct avt_fb *fb, avt_graphic * screen, int x, int y,
+	       int width, int height)
+{
+  struct fb_area area;
+
+  area.fb = fb;
+  area.screen = screen;
+
+  if (not fb->scale.xmap)
+    {
+      area.x = x;
+      area.width = width;
+
+      // big areas are updated in parallel, if threads are available
+      avt_bands (band_direct, &area, y, width, height);
+    }
+  else				// scaled
+    {
+      int first_y = fb->scale.first_y[y];
+
+      area.x = fb->scale.first_x[x];
+      area.width = fb->scale.first_x[x + width] - area.x;
+
+      avt_bands (band_scaled, &area, first_y, area.width,
+		 fb->scale.first_y[y + height] - first_y);
+    }
+}
+
+// map destination pixels to source pixels
+static void
+scale_map (bool smooth, int *map, uint_least16_t * frac, int *first,
+	   int source, int destination)
+{
+  int s;
+
+  for (int d = 0; d < destination; d++)
+    {
+      if (not smooth)
+	map[d] = ((2 * d + 1) * source) / (2 * destination);
+      else
+	{
+	  // position of the pixel center in 1/256 source pixels
+	  long long int pos;
+
+	  pos = ((2LL * d + 1) * source * 256) / (2 * destination) - 128;
+
+	  if (pos < 0)
+	    pos = 0;
+
+	  map[d] = (int) (pos >> 8);
+	  frac[d] = (uint_least16_t) (pos bitand 0xFF);
+
+	  // the next pixel must be inside
+	  if (map[d] >= source - 1)
+	    {
+	      map[d] = source - 2;
+	      frac[d] = 256;
+	    }
+	}
+    }
+
+  s = 0;
+  for (int d = 0; d < destination; d++)
+    while (s <= map[d])
+      first[s++] = d;
+
+  while (s <= source)
+    first[s++] = destination;
+}
+
+extern bool
+avt_fb_scale (struct avt_fb *fb, const char *mode, bool smooth,
+	      int *width, int *height)
+{
+  int factor, max_factor;
+
+  avt_fb_unscale (fb);
+
+  *width = fb->width;
+  *height = fb->height;
+
+  if (not mode or not * mode)
+    return false;
+
+  fb->scale.smooth = smooth;
+
+  max_factor = avt_min (fb->width / MINIMALWIDTH, fb->height / MINIMALHEIGHT);
+
+  if (strcmp (mode, "minimal") == 0)
+    {
+      // keep the aspect ratio
+      if (fb->width * MINIMALHEIGHT <= fb->height * MINIMALWIDTH)
+	{
+	  fb->scale.width = fb->width;
+	  fb->scale.height = fb->width * MINIMALHEIGHT / MINIMALWIDTH;
+	}
+      else
+	{
+	  fb->scale.height = fb->height;
+	  fb->scale.width = fb->height * MINIMALWIDTH / MINIMALHEIGHT;
+	}
+
+      *width = MINIMALWIDTH;
+      *height = MINIMALHEIGHT;
+    }
+  else
+    {
+      if (strcmp (mode, "auto") == 0)
+	factor = max_factor;
+      else
+	factor = avt_min ((int) strtol (mode, NULL, 10), max_factor);
+
+      if (factor <= 1)
+	return false;
+
+      *width = fb->width / factor;
+      *height = fb->height / factor;
+      fb->scale.width = *width * factor;
+      fb->scale.height = *height * factor;
+    }
+
+  if (fb->scale.width == *width and fb->scale.height == *height)
+    return false;
+
+  // center the area
+  fb->scale.x = (fb->width - fb->scale.width) / 2;
+  fb->scale.y = (fb->height - fb->scale.height) / 2;
+
+  // all maps in one allocation
+  fb->scale.xmap = (int *)
+    malloc ((2 * (fb->scale.width + fb->scale.height) + *width + *height + 2)
+	    * sizeof (int));
+
+  if (not fb->scale.xmap)
+    {
+      // just don't scale
+      *width = fb->width;
+      *height = fb->height;
+      return false;
+    }
+
+  fb->scale.ymap = fb->scale.xmap + fb->scale.width;
+  fb->scale.first_x = fb->scale.ymap + fb->scale.height;
+  fb->scale.first_y = fb->scale.first_x + *width + 1;
+  // the weights take the space of int values, to keep the alignment
+  fb->scale.xfrac = (uint_least16_t *) (fb->scale.first_y + *height + 1);
+  fb->scale.yfrac = fb->scale.xfrac + fb->scale.width;
+
+  scale_map (smooth, fb->scale.xmap, fb->scale.xfrac, fb->scale.first_x,
+	     *width, fb->scale.width);
+  scale_map (smooth, fb->scale.ymap, fb->scale.yfrac, fb->scale.first_y,
+	     *height, fb->scale.height);
+
+  return true;
+}
+
+extern void
+avt_fb_unscale (struct avt_fb *fb)
+{
+  free (fb->scale.xmap);
+  memset (&fb->scale, 0, sizeof (fb->scale));
+}
@@ -0,0 +1,105 @@
+/*
+ * performance counters for AKFAvatar
+ * Copyright (c) 2015 Andreas K. Foerster <akf@akfoerster.de>
+ *
+ * required standards: C99
+ *
+ * This file is part of AKFAvatar
+ *
+ * AKFAvatar is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * AKFAvatar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * The counters are increased with avt_count (see avtinternals.h).
+ * With GCC compatible compilers that is a relaxed atomic addition,
+ * so the values are correct, but not synchronized with each other.
+ * With AVT_NO_STATS the counting code is not compiled at all.
+ */
+
+#include "akfavatar.h"
+#include "avtinternals.h"
+#include <string.h>
+#include <iso646.h>
+
+static const char *const stat_names[AVT_STAT_COUNT] = {
+  [AVT_STAT_UPDATES] = "updates",
+  [AVT_STAT_UPDATE_PIXELS] = "update_pixels",
+  [AVT_STAT_UPDATE_NS] = "update_ns",
+  [AVT_STAT_GLYPHS] = "glyphs",
+  [AVT_STAT_IMAGE_DECODES] = "image_decodes",
+  [AVT_STAT_IMAGE_DECODE_NS] = "image_decode_ns",
+  [AVT_STAT_AUDIO_CALLBACKS] = "audio_callbacks",
+  [AVT_STAT_AUDIO_PARTIAL] = "audio_partial",
+};
+
+#ifndef AVT_NO_STATS
+
+uint_least64_t avt_stats[AVT_STAT_COUNT];
+
+extern void
+avt_count_update (int width, int height, uint_least64_t start)
+{
+  avt_count (AVT_STAT_UPDATES, 1);
+  avt_count (AVT_STAT_UPDATE_PIXELS, (uint_least64_t) width * height);
+  avt_count (AVT_STAT_UPDATE_NS, avt_stat_clock () - start);
+  avt_trace_complete ("update_area", start);
+}
+
+#endif // not AVT_NO_STATS
+
+
+extern size_t
+avt_get_stats (uint_least64_t * values, size_t count)
+{
+  if (not values)
+    return 0;
+
+  if (count > AVT_STAT_COUNT)
+    count = AVT_STAT_COUNT;
+
+#ifdef AVT_NO_STATS
+  memset (values, 0, count * sizeof (*values));
+#elif defined (__GNUC__)
+  for (size_t i = 0; i < count; i++)
+    values[i] = __atomic_load_n (&avt_stats[i], __ATOMIC_RELAXED);
+#else
+  memcpy (values, avt_stats, count * sizeof (*values));
+#endif
+
+  return count;
+}
+
+
+extern const char *
+avt_stat_name (int nr)
+{
+  if (nr < 0 or nr >= AVT_STAT_COUNT)
+    return NULL;
+
+  return stat_names[nr];
+}
+
+
+extern void
+avt_reset_stats (void)
+{
+#ifndef AVT_NO_STATS
+#ifdef __GNUC__
+  for (int i = 0; i < AVT_STAT_COUNT; i++)
+    __atomic_store_n (&avt_stats[i], 0, __ATOMIC_RELAXED);
+#else
+  memset (avt_stats, 0, sizeof (avt_stats));
+#endif
+#endif
+}
@@ -0,0 +1,236 @@
+/*
+ * worker threads for AKFAvatar
+ * Copyright (c) 2015 Andreas K. Foerster <akf@akfoerster.de>
+ *
+ * required standards: C99, POSIX.1-2001 (threads)
+ *
+ * This file is part of AKFAvatar
+ *
+ * AKFAvatar is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * AKFAvatar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Large areas are split into horizontal bands, which are handled
+ * in parallel.  The calling thread handles the first band itself.
+ * Define AVT_NO_THREADS for systems without POSIX threads.
+ */
+
+#define _ISOC99_SOURCE
+#define _XOPEN_SOURCE 600
+
+#include "akfavatar.h"
+#include "avtinternals.h"
+
+#include <stdint.h>
+#include <iso646.h>
+
+#ifndef AVT_NO_THREADS
+#include <pthread.h>
+#endif
+
+// areas with less pixels are handled in the calling thread
+#define AVT_BANDS_THRESHOLD  (64 * 1024)
+
+// at least so many lines per band
+#define AVT_BANDS_MIN_HEIGHT  16
+
+#ifndef AVT_NO_THREADS
+
+static struct
+{
+  int count;			// number of worker threads
+  pthread_t thread[AVT_MAX_THREADS];
+  pthread_mutex_t mutex;
+  pthread_cond_t start, done;
+  unsigned int generation;
+  int pending;
+  bool quit;
+
+  // the job
+  void (*band) (void *data, int y, int height);
+  void *data;
+  int y, height, band_height;
+} workers;
+
+
+static inline void
+do_band (int nr, void (*band) (void *, int, int), void *data,
+	 int y, int height, int band_height)
+{
+  int start = nr * band_height;
+
+  if (start < height)
+    {
+      avt_trace_begin ("band");
+      band (data, y + start, avt_min (band_height, height - start));
+      avt_trace_end ("band");
+    }
+}
+
+
+static void *
+worker (void *arg)
+{
+  int nr = (int) (intptr_t) arg;
+  unsigned int seen = 0;
+
+  pthread_mutex_lock (&workers.mutex);
+
+  while (true)
+    {
+      while (workers.generation == seen and not workers.quit)
+	pthread_cond_wait (&workers.start, &workers.mutex);
+
+      if (workers.quit)
+	break;
+
+      seen = workers.generation;
+
+      pthread_mutex_unlock (&workers.mutex);
+      avt_trace_thread ("band worker");
+      do_band (nr, workers.band, workers.data, workers.y, workers.height,
+	       workers.band_height);
+      pthread_mutex_lock (&workers.mutex);
+
+      if (--workers.pending == 0)
+	pthread_cond_signal (&workers.done);
+    }
+
+  pthread_mutex_unlock (&workers.mutex);
+
+  return NULL;
+}
+
+
+extern int
+avt_start_threads (int threads)
+{
+  // the calling thread is one of them
+  threads--;
+
+  if (threads > AVT_MAX_THREADS)
+    threads = AVT_MAX_THREADS;
+
+  if (workers.count > 0 or threads <= 0)
+    return workers.count + 1;
+
+  pthread_mutex_init (&workers.mutex, NULL);
+  pthread_cond_init (&workers.start, NULL);
+  pthread_cond_init (&workers.done, NULL);
+  workers.quit = false;
+  workers.generation = 0;
+
+  for (int i = 0; i < threads; i++)
+    {
+      if (pthread_create (&workers.thread[i], NULL, worker,
+			  (void *) (intptr_t) (i + 1)) != 0)
+	break;
+
+      workers.count++;
+    }
+
+  return workers.count + 1;
+}
+
+
+extern void
+avt_quit_threads (void)
+{
+  if (workers.count <= 0)
+    return;
+
+  pthread_mutex_lock (&workers.mutex);
+  workers.quit = true;
+  pthread_cond_broadcast (&workers.start);
+  pthread_mutex_unlock (&workers.mutex);
+
+  for (int i = 0; i < workers.count; i++)
+    pthread_join (workers.thread[i], NULL);
+
+  pthread_cond_destroy (&workers.done);
+  pthread_cond_destroy (&workers.start);
+  pthread_mutex_destroy (&workers.mutex);
+  workers.count = 0;
+}
+
+
+extern void
+avt_bands (void (*band) (void *data, int y, int height), void *data,
+	   int y, int width, int height)
+{
+  int bands, band_height;
+
+  if (width <= 0 or height <= 0)
+    return;
+
+  bands = workers.count + 1;
+
+  if (bands > height / AVT_BANDS_MIN_HEIGHT)
+    bands = height / AVT_BANDS_MIN_HEIGHT;
+
+  if (bands <= 1 or width * height < AVT_BANDS_THRESHOLD)
+    {
+      band (data, y, height);
+      return;
+    }
+
+  band_height = (height + bands - 1) / bands;
+
+  pthread_mutex_lock (&workers.mutex);
+  workers.band = band;
+  workers.data = data;
+  workers.y = y;
+  workers.height = height;
+  workers.band_height = band_height;
+  workers.pending = workers.count;
+  workers.generation++;
+  pthread_cond_broadcast (&workers.start);
+  pthread_mutex_unlock (&workers.mutex);
+
+  // the first band is done here
+  do_band (0, band, data, y, height, band_height);
+
+  pthread_mutex_lock (&workers.mutex);
+  while (workers.pending > 0)
+    pthread_cond_wait (&workers.done, &workers.mutex);
+  pthread_mutex_unlock (&workers.mutex);
+}
+
+#else // AVT_NO_THREADS
+
+extern int
+avt_start_threads (int threads)
+{
+  (void) threads;
+
+  return 1;
+}
+
+
+extern void
+avt_quit_threads (void)
+{
+  // nothing to do
+}
+
+
+extern void
+avt_bands (void (*band) (void *data, int y, int height), void *data,
+	   int y, int width, int height)
+{
+  if (width > 0 and height > 0)
+    band (data, y, height);
+}
+
+#endif // AVT_NO_THREADS
@@ -18,50 +18,173 @@
  * along with this program; if not, see <http://www.gnu.org/licenses/>.
  */
 
+/*
+ * The time is taken from the monotonic clock, when available,
+ * so it doesn't jump when the system time is changed.
+ * The values count from the first call.
+ *
+ * With virtual time (for the headless backend) the time only
+ * advances, when somebody sleeps, and sleeping takes no real time.
+ */
+
 #define _ISOC99_SOURCE
 #define _XOPEN_SOURCE 600
 
 #include "akfavatar.h"
+#include "avtinternals.h"
 #include <iso646.h>
+#include <unistd.h>		// evtl. defines _POSIX_MONOTONIC_CLOCK
 #include <time.h>
 #include <sys/time.h>
 
+#if defined(_POSIX_MONOTONIC_CLOCK) and _POSIX_MONOTONIC_CLOCK >= 0
+#  define MONOTONIC 1
+#endif
 
-static struct timeval start_ticks;
+// slices for avt_sleep_until, so that events are handled
+#define SLEEP_SLICE  (100 * UINT64_C (1000000))
 
-extern size_t
-avt_ticks (void)
+static uint_least64_t start_ns;
+static bool virtual_time;
+static uint_least64_t virtual_ns;
+
+// absolute time in nanoseconds, never virtual
+extern uint_least64_t
+avt_clock_ns (void)
 {
-  struct timeval now;
+#ifdef MONOTONIC
+  struct timespec now;
+
+  if (clock_gettime (CLOCK_MONOTONIC, &now) == 0)
+    return (uint_least64_t) now.tv_sec * 1000000000u + now.tv_nsec;
+#endif
 
   // conforming to POSIX.1-2001
-  gettimeofday (&now, NULL);
+  struct timeval tv;
 
-  if (not start_ticks.tv_sec)
-    start_ticks = now;
+  gettimeofday (&tv, NULL);
+  return (uint_least64_t) tv.tv_sec * 1000000000u + tv.tv_usec * 1000u;
+}
+
+
+extern uint_least64_t
+avt_ticks_ns (void)
+{
+  if (virtual_time)
+    return virtual_ns;
 
-  return ((now.tv_sec - start_ticks.tv_sec) * 1000)
-    + ((now.tv_usec - start_ticks.tv_usec) / 1000);
+  uint_least64_t now = avt_clock_ns ();
+
+  if (not start_ns)
+    start_ns = now - 1;		// never 0
+
+  return now - start_ns;
 }
 
 
-// conforming to POSIX.1-2001
+extern size_t
+avt_ticks (void)
+{
+  return (size_t) (avt_ticks_ns () / 1000000u);
+}
+
+
+// sleeps until the deadline without handling events
 extern void
-avt_delay (int milliseconds)
+avt_delay_until (uint_least64_t deadline)
 {
-  struct timespec time, remaining;
-  int r;
+  uint_least64_t now;
+
+  now = avt_ticks_ns ();
 
-  if (milliseconds <= 0)
+  if (deadline <= now)
     return;
 
-  remaining.tv_sec = milliseconds / 1000;
-  remaining.tv_nsec = (milliseconds % 1000) * 1000000;
+  if (virtual_time)
+    {
+      virtual_ns = deadline;
+      return;
+    }
+
+#if defined(MONOTONIC) and defined(TIMER_ABSTIME)
+  {
+    struct timespec t;
+    uint_least64_t absolute = deadline + start_ns;
+
+    t.tv_sec = absolute / 1000000000u;
+    t.tv_nsec = absolute % 1000000000u;
+
+    // restarted after signals
+    while (clock_nanosleep (CLOCK_MONOTONIC, TIMER_ABSTIME, &t, NULL) != 0
+	   and avt_ticks_ns () < deadline)
+      ;
+
+    return;
+  }
+#endif
 
+  // relative sleep, recalculated after signals
   do
     {
-      time = remaining;
-      r = nanosleep (&time, &remaining);
+      struct timespec t;
+      uint_least64_t rest = deadline - now;
+
+      t.tv_sec = rest / 1000000000u;
+      t.tv_nsec = rest % 1000000000u;
+      nanosleep (&t, NULL);
+
+      now = avt_ticks_ns ();
+    }
+  while (now < deadline);
+}
+
+
+extern int
+avt_sleep_until (uint_least64_t deadline)
+{
+  uint_least64_t now;
+
+  avt_trace_begin ("sleep");
+  now = avt_ticks_ns ();
+
+  while (now < deadline and _avt_STATUS == AVT_NORMAL)
+    {
+      if (deadline - now > SLEEP_SLICE)
+	avt_delay_until (now + SLEEP_SLICE);
+      else
+	avt_delay_until (deadline);
+
+      avt_update ();
+      now = avt_ticks_ns ();
+    }
+
+  avt_trace_end ("sleep");
+
+  return _avt_STATUS;
+}
+
+
+extern void
+avt_delay (int milliseconds)
+{
+  if (milliseconds > 0)
+    avt_delay_until (avt_ticks_ns ()
+		     + (uint_least64_t) milliseconds * 1000000u);
+}
+
+
+// the ticks continue from where they are when switching
+extern void
+avt_virtual_time (bool on)
+{
+  if (on and not virtual_time)
+    {
+      virtual_ns = avt_ticks_ns ();
+      virtual_time = true;
+    }
+  else if (not on and virtual_time)
+    {
+      virtual_time = false;
+      start_ns = avt_clock_ns () - virtual_ns;
     }
-  while (r == -1);
 }
@@ -0,0 +1,322 @@
+/*
+ * tracing for AKFAvatar in the Chrome trace format
+ * Copyright (c) 2015 Andreas K. Foerster <akf@akfoerster.de>
+ *
+ * required standards: C99, GCC compatible atomics and thread-local data
+ *
+ * This file is part of AKFAvatar
+ *
+ * AKFAvatar is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * AKFAvatar is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Every thread writes its events into its own ring buffer without
+ * any locks, so the audio thread is never blocked.  The buffers are
+ * only added to a list, never removed.  When a ring buffer is full,
+ * the oldest events are overwritten.
+ *
+ * The file is written when tracing is stopped, at the exit of the
+ * program or after the signal SIGUSR1 with the next event of the
+ * thread which started the tracing.  Events, which are written by
+ * other threads at the same time, may be garbled in the file.
+ *
+ * The names of the events are not copied, they must be constant.
+ * The file can be viewed with chrome://tracing or Perfetto.
+ */
+
+#define _ISOC99_SOURCE
+#define _XOPEN_SOURCE 600
+
+#include "akfavatar.h"
+#include "avtinternals.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <iso646.h>
+
+#ifdef AVT_TRACE
+
+// events per thread, must be a power of 2
+#define TRACE_EVENTS  (16 * 1024)
+
+struct trace_event
+{
+  const char *name;
+  uint_least64_t time, duration;	// nanoseconds from avt_clock_ns
+  char phase;			// 'B' begin, 'E' end, 'X' complete
+};
+
+struct trace_buffer
+{
+  struct trace_buffer *next;
+  const char *name;
+  int tid;
+  uint_least64_t head;		// number of events written
+  struct trace_event event[TRACE_EVENTS];
+};
+
+static bool tracing;
+
+static __thread struct trace_buffer *local;
+static struct trace_buffer *buffers;
+static int thread_count;
+
+static char *trace_file;
+static uint_least64_t trace_start;
+static struct trace_buffer *main_buffer;
+static volatile sig_atomic_t dump_requested;
+static bool handlers_installed;
+
+
+// the buffer of the calling thread, created on its first event
+static struct trace_buffer *
+trace_buffer (void)
+{
+  struct trace_buffer *b;
+
+  if (local)
+    return local;
+
+  b = (struct trace_buffer *) calloc (1, sizeof (*b));
+  if (not b)
+    return NULL;
+
+  b->tid = __atomic_add_fetch (&thread_count, 1, __ATOMIC_RELAXED);
+  b->next = __atomic_load_n (&buffers, __ATOMIC_RELAXED);
+
+  while (not __atomic_compare_exchange_n (&buffers, &b->next, b, true,
+					  __ATOMIC_RELEASE,
+					  __ATOMIC_RELAXED))
+    ;
+
+  local = b;
+
+  return b;
+}
+
+
+static void
+trace_dump (void)
+{
+  FILE *f;
+
+  if (not trace_file)
+    return;
+
+  f = fopen (trace_file, "w");
+  if (not f)
+    return;
+
+  fputs ("{\"traceEvents\":[\n", f);
+
+  for (struct trace_buffer * b = __atomic_load_n (&buffers, __ATOMIC_ACQUIRE);
+       b; b = b->next)
+    {
+      uint_least64_t head, i;
+
+      fprintf (f, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+	       "\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+	       b->tid, b->name ? b->name : "thread");
+
+      head = __atomic_load_n (&b->head, __ATOMIC_ACQUIRE);
+      i = (head > TRACE_EVENTS) ? head - TRACE_EVENTS : 0;
+
+      for (; i < head; i++)
+	{
+	  const struct trace_event *e = &b->event[i bitand (TRACE_EVENTS - 1)];
+
+	  // from an earlier tracing
+	  if (e->time < trace_start)
+	    continue;
+
+	  fprintf (f, ",\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,",
+		   e->name, e->phase, (e->time - trace_start) / 1000.0);
+
+	  if (e->phase == 'X')
+	    fprintf (f, "\"dur\":%.3f,", e->duration / 1000.0);
+
+	  fprintf (f, "\"pid\":1,\"tid\":%d}", b->tid);
+	}
+
+      fputs (b->next ? ",\n" : "\n", f);
+    }
+
+  fputs ("],\"displayTimeUnit\":\"ms\"}\n", f);
+  fclose (f);
+}
+
+
+static void
+trace_event (const char *name, char phase, uint_least64_t start)
+{
+  struct trace_buffer *b;
+  struct trace_event *e;
+  uint_least64_t now;
+
+  now = avt_clock_ns ();
+  b = trace_buffer ();
+  if (not b)
+    return;
+
+  e = &b->event[b->head bitand (TRACE_EVENTS - 1)];
+  e->name = name;
+  e->phase = phase;
+
+  if (phase == 'X')
+    {
+      e->time = start;
+      e->duration = now - start;
+    }
+  else
+    {
+      e->time = now;
+      e->duration = 0;
+    }
+
+  // the event must be complete, before it is counted
+  __atomic_store_n (&b->head, b->head + 1, __ATOMIC_RELEASE);
+
+  if (dump_requested and b == main_buffer)
+    {
+      dump_requested = 0;
+      trace_dump ();
+    }
+}
+
+
+extern void
+avt_trace_begin (const char *name)
+{
+  if (__atomic_load_n (&tracing, __ATOMIC_RELAXED) and name)
+    trace_event (name, 'B', 0);
+}
+
+
+extern void
+avt_trace_end (const char *name)
+{
+  if (__atomic_load_n (&tracing, __ATOMIC_RELAXED) and name)
+    trace_event (name, 'E', 0);
+}
+
+
+extern void
+avt_trace_complete (const char *name, uint_least64_t start)
+{
+  if (__atomic_load_n (&tracing, __ATOMIC_RELAXED))
+    trace_event (name, 'X', start);
+}
+
+
+extern void
+avt_trace_thread (const char *name)
+{
+  if (__atomic_load_n (&tracing, __ATOMIC_RELAXED))
+    {
+      struct trace_buffer *b = trace_buffer ();
+
+      if (b and not b->name)
+	b->name = name;
+    }
+}
+
+
+#ifdef SIGUSR1
+static void
+trace_signal (int sig)
+{
+  signal (sig, trace_signal);	// for old System V semantics
+  dump_requested = 1;
+}
+#endif
+
+
+static void
+trace_exit (void)
+{
+  avt_trace (NULL);
+}
+
+
+extern int
+avt_trace (const char *filename)
+{
+  size_t length;
+
+  if (tracing)
+    {
+      __atomic_store_n (&tracing, false, __ATOMIC_RELAXED);
+      trace_dump ();
+      free (trace_file);
+      trace_file = NULL;
+    }
+
+  if (not filename or not * filename)
+    return _avt_STATUS;
+
+  length = strlen (filename) + 1;
+  trace_file = (char *) malloc (length);
+  if (not trace_file)
+    {
+      avt_set_error ("out of memory");
+      return AVT_FAILURE;
+    }
+
+  memcpy (trace_file, filename, length);
+
+  trace_start = avt_clock_ns ();
+  main_buffer = trace_buffer ();
+  if (main_buffer)
+    main_buffer->name = "main";
+
+  if (not handlers_installed)
+    {
+      atexit (trace_exit);
+#ifdef SIGUSR1
+      signal (SIGUSR1, trace_signal);
+#endif
+      handlers_installed = true;
+    }
+
+  __atomic_store_n (&tracing, true, __ATOMIC_RELAXED);
+
+  return _avt_STATUS;
+}
+
+#else // not AVT_TRACE
+
+extern void
+avt_trace_begin (const char *name)
+{
+  (void) name;
+}
+
+extern void
+avt_trace_end (const char *name)
+{
+  (void) name;
+}
+
+extern int
+avt_trace (const char *filename)
+{
+  if (not filename)
+    return _avt_STATUS;
+
+  avt_set_error ("tracing not available");
+  return AVT_FAILURE;
+}
+
+#endif // not AVT_TRACE
@@ -178,27 +178,27 @@ avt_load_image_xbm_data (avt_data * src, avt_color color)
   // search start of bitmap part
   if (not end and not error)
     {
-      char c;
+      int c;
 
       avt_data_seek (src, start, SEEK_SET);
 
       do
+	c = avt_data_getc (src);
+      while (c != '{' and c != EOF);
+
+      if (c == EOF)		// no '{' found
 	{
-	  if (avt_data_read (src, &c, sizeof (c), 1) < 1)
-	    error = end = true;
+	  error = end = true;
+	  goto done;
 	}
-      while (c != '{' and not error);
-
-      if (error)		// no '{' found
-	goto done;
 
       // skip newline
-      avt_data_read (src, &c, sizeof (c), 1);
+      avt_data_getc (src);
     }
 
   while (not end and not error)
     {
-      char c;
+      int c;
       unsigned int linepos;
 
       // read line
@@ -206,11 +206,12 @@ avt_load_image_xbm_data (avt_data * src, avt_color color)
       c = '\0';
       while (not end and linepos < sizeof (line) and c != '\n')
 	{
-	  if (avt_data_read (src, &c, sizeof (c), 1) < 1)
-	    error = end = true;
+	  c = avt_data_getc (src);
 
-	  if (c != '\n' and c != '}')
-	    line[linepos++] = c;
+	  if (c == EOF)
+	    error = end = true;
+	  else if (c != '\n' and c != '}')
+	    line[linepos++] = (char) c;
 
 	  if (c == '}')
 	    end = true;
@@ -1,6 +1,6 @@
 /*
  * X-Pixmap (XPM) support for AKFAvatar
- * Copyright (c) 2007,2008,2009,2010,2011,2012,2013
+ * Copyright (c) 2007,2008,2009,2010,2011,2012,2013,2015
  * Andreas K. Foerster <akf@akfoerster.de>
  *
  * required standards: C99, POSIX.1-2001
@@ -35,29 +35,234 @@
 // number of printable ASCII codes
 #define XPM_NR_CODES (126 - 32 + 1)
 
-// for xpm codes
-union xpm_codes
+// index of a printable ASCII code, or XPM_NR_CODES or more if it isn't one
+#define xpm_code(c)  ((unsigned int) ((uint_least8_t) (c) - 32))
+
+/*
+ * color tables:
+ * for 1 or 2 characters per pixel the codes directly index a flat table
+ * (95 or 95*95 entries), for 3 or 4 characters per pixel an open
+ * addressing hash table is used with the packed characters as key
+ */
+
+struct xpm_entry
 {
-  uint_least32_t nr;
-  union xpm_codes *next;
+  uint_least32_t key;		// 0 for unused
+  avt_color color;
 };
 
+struct xpm_table
+{
+  avt_color *direct;		// for cpp 1 or 2
+  struct xpm_entry *hash;	// for cpp 3 or 4
+  int bits;			// size of hash table is 2^bits
+};
+
+static inline unsigned int
+xpm_hash (uint_least32_t key, int bits)
+{
+  return (uint_least32_t) (key * UINT32_C (0x9E3779B1)) >> (32 - bits);
+}
+
+// pack the characters into a key, 0 on invalid characters
+static inline uint_least32_t
+xpm_key (const char *p, int cpp)
+{
+  uint_least32_t key = 0;
+
+  for (int i = 0; i < cpp; i++)
+    {
+      if (xpm_code (p[i]) >= XPM_NR_CODES)
+	return 0;
+
+      key = (key << 8) bitor (uint_least8_t) p[i];
+    }
+
+  return key;
+}
+
+static bool
+xpm_table_new (struct xpm_table *table, int cpp, int ncolors)
+{
+  table->direct = NULL;
+  table->hash = NULL;
+  table->bits = 0;
+
+  switch (cpp)
+    {
+    case 1:
+      table->direct = (avt_color *) calloc (XPM_NR_CODES, sizeof (avt_color));
+      return (table->direct != NULL);
+
+    case 2:
+      table->direct = (avt_color *)
+	calloc (XPM_NR_CODES * XPM_NR_CODES, sizeof (avt_color));
+      return (table->direct != NULL);
+
+    default:
+      // at most half full
+      table->bits = 1;
+      while ((1L << table->bits) < 2L * ncolors)
+	table->bits++;
+
+      table->hash = (struct xpm_entry *)
+	calloc (1UL << table->bits, sizeof (struct xpm_entry));
+      return (table->hash != NULL);
+    }
+}
+
 static void
-avt_free_xpm_tree (union xpm_codes *tree, int depth, int cpp)
+xpm_table_free (struct xpm_table *table)
+{
+  if (table->direct)
+    free (table->direct);
+
+  if (table->hash)
+    free (table->hash);
+}
+
+// returns false for invalid characters
+static bool
+xpm_table_set (struct xpm_table *table, const char *p, int cpp,
+	       avt_color color)
+{
+  if (cpp <= 2)
+    {
+      unsigned int i = xpm_code (p[0]);
+
+      if (i >= XPM_NR_CODES)
+	return false;
+
+      if (cpp == 2)
+	{
+	  unsigned int c2 = xpm_code (p[1]);
+
+	  if (c2 >= XPM_NR_CODES)
+	    return false;
+
+	  i = i * XPM_NR_CODES + c2;
+	}
+
+      table->direct[i] = color;
+    }
+  else
+    {
+      uint_least32_t key = xpm_key (p, cpp);
+      unsigned int mask = (1U << table->bits) - 1;
+      unsigned int i;
+
+      if (not key)
+	return false;
+
+      i = xpm_hash (key, table->bits);
+      while (table->hash[i].key and table->hash[i].key != key)
+	i = (i + 1) bitand mask;
+
+      table->hash[i].key = key;
+      table->hash[i].color = color;
+    }
+
+  return true;
+}
+
+/*
+ * pixel row decoders, one for each number of characters per pixel;
+ * they stop at the first invalid character (also at the end of the string)
+ * and return the number of pixels written
+ */
+
+static int
+xpm_row_1 (const struct xpm_table *table, avt_color * pix,
+	   const char *p, int width)
+{
+  const avt_color *colors = table->direct;
+  int x;
+
+  for (x = 0; x < width; x++)
+    {
+      unsigned int c = xpm_code (p[x]);
+
+      if (c >= XPM_NR_CODES)
+	break;
+
+      pix[x] = colors[c];
+    }
+
+  return x;
+}
+
+static int
+xpm_row_2 (const struct xpm_table *table, avt_color * pix,
+	   const char *p, int width)
+{
+  const avt_color *colors = table->direct;
+  int x;
+
+  for (x = 0; x < width; x++, p += 2)
+    {
+      unsigned int c1, c2;
+
+      c1 = xpm_code (p[0]);
+      if (c1 >= XPM_NR_CODES)
+	break;
+
+      c2 = xpm_code (p[1]);
+      if (c2 >= XPM_NR_CODES)
+	break;
+
+      pix[x] = colors[c1 * XPM_NR_CODES + c2];
+    }
+
+  return x;
+}
+
+static inline int
+xpm_row_hash (const struct xpm_table *table, avt_color * pix,
+	      const char *p, int width, int cpp)
 {
-  union xpm_codes *e;
+  const struct xpm_entry *hash = table->hash;
+  unsigned int mask = (1U << table->bits) - 1;
+  uint_least32_t last_key = 0;
+  avt_color last_color = 0;
+  int x;
 
-  if (depth < cpp)
+  for (x = 0; x < width; x++, p += cpp)
     {
-      for (int i = 0; i < XPM_NR_CODES; i++)
+      uint_least32_t key = xpm_key (p, cpp);
+
+      if (not key)
+	break;
+
+      // neighboring pixels often have the same color
+      if (key != last_key)
 	{
-	  e = (tree + i)->next;
-	  if (e)
-	    avt_free_xpm_tree (e, depth + 1, cpp);
+	  unsigned int i = xpm_hash (key, table->bits);
+
+	  while (hash[i].key and hash[i].key != key)
+	    i = (i + 1) bitand mask;
+
+	  last_key = key;
+	  last_color = hash[i].color;	// 0 (black) if undefined
 	}
+
+      pix[x] = last_color;
     }
 
-  free (tree);
+  return x;
+}
+
+static int
+xpm_row_3 (const struct xpm_table *table, avt_color * pix,
+	   const char *p, int width)
+{
+  return xpm_row_hash (table, pix, p, width, 3);
+}
+
+static int
+xpm_row_4 (const struct xpm_table *table, avt_color * pix,
+	   const char *p, int width)
+{
+  return xpm_row_hash (table, pix, p, width, 4);
 }
 
 extern avt_graphic *
@@ -65,14 +270,14 @@ avt_load_image_xpm (char **xpm)
 {
   avt_graphic *img;
   int width, height, ncolors, cpp;
-  union xpm_codes *codes;
-  avt_color *colors;
-  int code_nr;
+  struct xpm_table table;
+  int (*decode_row) (const struct xpm_table *, avt_color *,
+		     const char *, int);
 
   cpp = 0;
-  codes = NULL;
-  colors = NULL;
   img = NULL;
+  table.direct = NULL;
+  table.hash = NULL;
 
   // check if we actually have data to process
   if (not xpm or not * xpm)
@@ -96,44 +301,43 @@ avt_load_image_xpm (char **xpm)
       or ncolors > 0xFFFFFF or cpp > 4 or width > 10000 or height > 10000)
     goto done;
 
+  switch (cpp)
+    {
+    case 1:
+      decode_row = xpm_row_1;
+      break;
+
+    case 2:
+      decode_row = xpm_row_2;
+      break;
+
+    case 3:
+      decode_row = xpm_row_3;
+      break;
+
+    default:
+      decode_row = xpm_row_4;
+      break;
+    }
+
   // create target surface
   img = avt_new_graphic (width, height);
 
   if (not img)
     goto done;
 
-  // get memory for codes table
-  if (cpp > 1)
-    {
-      codes = (union xpm_codes *) calloc (XPM_NR_CODES, sizeof (*codes));
-      if (not codes)
-	{
-	  avt_free_graphic (img);
-	  img = NULL;
-	  goto done;
-	}
-    }
-
-  // get memory for colors table (palette)
-  // note: for 1 character per pixel we use the character-32 as index
-  if (cpp == 1)
-    colors = (avt_color *) malloc (XPM_NR_CODES * sizeof (avt_color));
-  else
-    colors = (avt_color *) malloc (ncolors * sizeof (avt_color));
-
-  if (not colors)
+  if (not xpm_table_new (&table, cpp, ncolors))
     {
       avt_free_graphic (img);
       img = NULL;
       goto done;
     }
 
-  code_nr = 0;
-
   // process colors
-  for (int colornr = 1; colornr <= ncolors; colornr++, code_nr++)
+  for (int colornr = 1; colornr <= ncolors; colornr++)
     {
       char *p;			// pointer for scanning through the string
+      avt_color color;
 
       if (xpm[colornr] == NULL)
 	{
@@ -142,45 +346,9 @@ avt_load_image_xpm (char **xpm)
 	  goto done;
 	}
 
-      /*
-       * if there is only one character per pixel,
-       * the character is the palette number (simpler)
-       */
-      if (cpp == 1)
-	code_nr = xpm[colornr][0] - 32;
-      else			// store characters in codes table
-	{
-	  char c;
-	  union xpm_codes *table;
-
-	  c = '\0';
-	  table = codes;
-	  for (int i = 0; i < cpp - 1; i++)
-	    {
-	      c = xpm[colornr][i];
-
-	      if (c < 32 or c > 126)
-		break;
-
-	      table = (table + (c - 32));
-
-	      if (not table->next)
-		table->next =
-		  (union xpm_codes *) calloc (XPM_NR_CODES, sizeof (*codes));
-
-	      table = table->next;
-	    }
-
-	  if (c < 32 or c > 126)
-	    break;
-
-	  c = xpm[colornr][cpp - 1];
-
-	  if (c < 32 or c > 126)
-	    break;
-
-	  (table + (c - 32))->nr = colornr - 1;
-	}
+      // check the color characters (also for the end of the string)
+      if (not xpm_key (xpm[colornr], cpp))
+	break;
 
       // scan for color definition
       p = &xpm[colornr][cpp];	// skip color-characters
@@ -217,9 +385,10 @@ avt_load_image_xpm (char **xpm)
 	    p++;
 	}
 
+      color = 0x000000;		// black
+
       if (*p)
 	{
-	  int colornr;
 	  size_t color_name_pos;
 	  char color_name[80];
 
@@ -235,93 +404,50 @@ avt_load_image_xpm (char **xpm)
 	    color_name[color_name_pos++] = *p++;
 	  color_name[color_name_pos] = '\0';
 
-	  colornr = 0x000000;	// black
-
 	  if (color_name[0] == '#')
-	    colornr = strtol (&color_name[1], NULL, 16);
+	    color = strtol (&color_name[1], NULL, 16);
 	  else if (strcasecmp (color_name, "None") == 0)
 	    {
-	      colornr = AVT_TRANSPARENT;
-	      avt_set_color_key (img, colornr);
+	      color = AVT_TRANSPARENT;
+	      avt_set_color_key (img, color);
 	    }
 	  else if (strcasecmp (color_name, "black") == 0)
-	    colornr = 0x000000;
+	    color = 0x000000;
 	  else if (strcasecmp (color_name, "white") == 0)
-	    colornr = 0xFFFFFF;
+	    color = 0xFFFFFF;
 
 	  /*
 	   * Note: don't use avt_colorname,
 	   * or the palette is always needed
 	   */
-
-	  colors[code_nr] = colornr;
 	}
+
+      if (not xpm_table_set (&table, xpm[colornr], cpp, color))
+	break;
     }
 
   // process pixeldata
-  if (cpp == 1)			// the easiest case
-    {
-      avt_color *pix;
-      uint_least8_t *xpm_data;
-
-      for (int line = 0; line < height; line++)
-	{
-	  // point to beginning of the line
-	  pix = avt_pixel (img, 0, line);
-	  xpm_data = (uint_least8_t *) xpm[ncolors + 1 + line];
+  bool ended = false;
 
-	  for (int pos = width; pos > 0; pos--, pix++, xpm_data++)
-	    *pix = colors[*xpm_data - 32];
-	}
-    }
-  else				// cpp != 1
+  for (int line = 0; line < height; line++)
     {
-      avt_color *pix;
-      uint_least8_t *xpm_line;
+      avt_color *pix = avt_pixel (img, 0, line);
+      int x = 0;
 
-      for (int line = 0; line < height; line++)
-	{
-	  // point to beginning of the line
-	  pix = avt_pixel (img, 0, line);
-	  xpm_line = (uint_least8_t *) xpm[ncolors + 1 + line];
+      // premature end of data
+      if (not ended and not xpm[ncolors + 1 + line])
+	ended = true;
 
-	  for (int pos = 0; pos < width; pos++, pix++)
-	    {
-	      union xpm_codes *table;
-	      uint_least8_t c;
-
-	      c = '\0';
-	      // find code in codes table
-	      table = codes;
-	      for (int i = 0; i < cpp - 1; i++)
-		{
-		  c = xpm_line[pos * cpp + i];
-		  if (c < 32 or c > 126)
-		    break;
-		  table = (table + (c - 32))->next;
-		}
-
-	      if (c < 32 or c > 126)
-		break;
-
-	      c = xpm_line[pos * cpp + cpp - 1];
-	      if (c < 32 or c > 126)
-		break;
-
-	      code_nr = (table + (c - 32))->nr;
-
-	      *pix = colors[code_nr];
-	    }
-	}
+      if (not ended)
+	x = decode_row (&table, pix, xpm[ncolors + 1 + line], width);
+
+      // the buffer may be recycled, so the rest must not stay undefined
+      for (; x < width; x++)
+	pix[x] = 0x000000;
     }
 
 done:
-  if (colors)
-    free (colors);
-
-  // clean up codes table
-  if (codes)
-    avt_free_xpm_tree (codes, 1, cpp);
+  xpm_table_free (&table);
 
   return img;
 }
@@ -335,7 +461,7 @@ avt_load_image_xpm_data (avt_data * src)
   char *line;
   unsigned int linepos, linenr, linecount, linecapacity;
   avt_graphic *img;
-  char c;
+  int c;
   bool end, error;
 
   if (not src)
@@ -373,22 +499,23 @@ avt_load_image_xpm_data (avt_data * src)
     {
       // skip to next quote
       do
-	{
-	  if (avt_data_read (src, &c, sizeof (c), 1) < 1)
-	    end = true;
-	}
-      while (not end and c != '"');
+	c = avt_data_getc (src);
+      while (c != EOF and c != '"');
+
+      if (c == EOF)
+	end = true;
 
       // read line
       linepos = 0;
       c = '\0';
       while (not end and c != '"')
 	{
-	  if (avt_data_read (src, &c, sizeof (c), 1) < 1)
-	    error = end = true;	// shouldn't happen here
+	  c = avt_data_getc (src);
 
-	  if (c != '"')
-	    line[linepos++] = c;
+	  if (c == EOF)
+	    error = end = true;	// shouldn't happen here
+	  else if (c != '"')
+	    line[linepos++] = (char) c;
 
 	  if (linepos >= linecapacity)
 	    {
@@ -238,9 +238,8 @@ avt_set_avatar_name_char (const char *name)
 }
 
 /*
- * The pager and credits may be used with longer texts, so I use malloc.
- * Wide strings are up to 4 bytes per char,
- * in UTF-32 but also in UTF-16, because of surrogate codes.
+ * The pager decodes only the lines, which it shows,
+ * so the text does not need to be converted here.
  */
 
 extern int
@@ -254,16 +253,7 @@ avt_pager_char (const char *txt, size_t len, int startline)
       if (not len)
 	len = strlen (txt);
 
-      // no terminator needed
-      // ignore UTF-16 surrogates, UTF-8 would also have 4 Bytes then
-      wchar_t *wctext = malloc (len * sizeof (wchar_t));
-
-      if (wctext)
-	{
-	  size_t chars = char_to_wchar (wctext, len, txt, len);
-	  status = avt_pager (wctext, chars, startline);
-	  free (wctext);
-	}
+      status = avt_pager_encoded (txt, len, startline, convert);
     }
 
   return status;
@@ -28,6 +28,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <dirent.h>
 #include <sys/stat.h>
 #include <unistd.h>
@@ -50,10 +51,31 @@
 #  define avt_ask_drive(max_idx) 0	// dummy
 #endif
 
+// the type is only checked with stat, when it is needed
+enum fc_type
+{ FC_UNKNOWN, FC_FILE, FC_DIRECTORY };
+
+// the strings are offsets in the arena
+struct fc_entry
+{
+  size_t name;
+  size_t key;			// collation key
+  enum fc_type type;
+};
+
+// directory with all names in one arena
+struct fc_directory
+{
+  struct fc_entry *entries;
+  int count, capacity;
+  char *arena;
+  size_t arena_size, arena_capacity;
+};
+
 struct avt_fc_data
 {
   avt_color markcolor;
-  struct dirent **namelist;
+  struct fc_directory dir;
 };
 
 
@@ -78,14 +100,31 @@ is_directory (const char *name)
 }
 
 #ifdef _DIRENT_HAVE_D_TYPE
-#  define is_dirent_directory(d) \
-	    (d->d_type == DT_DIR \
-	      or ((d->d_type == DT_UNKNOWN or d->d_type == DT_LNK) \
-	             and is_directory (d->d_name)))
+#  define dirent_type(d) \
+	    (d->d_type == DT_DIR ? FC_DIRECTORY \
+	     : d->d_type == DT_REG ? FC_FILE : FC_UNKNOWN)
 #else
-#  define is_dirent_directory(d) (is_directory (d->d_name))
+#  define dirent_type(d) FC_UNKNOWN
 #endif // _DIRENT_HAVE_D_TYPE
 
+static inline const char *
+entry_name (const struct fc_directory *dir, int nr)
+{
+  return dir->arena + dir->entries[nr].name;
+}
+
+// checks the type only when it's not known yet
+static bool
+is_entry_directory (struct fc_directory *dir, int nr)
+{
+  struct fc_entry *e = &dir->entries[nr];
+
+  if (e->type == FC_UNKNOWN)
+    e->type = is_directory (entry_name (dir, nr)) ? FC_DIRECTORY : FC_FILE;
+
+  return (e->type == FC_DIRECTORY);
+}
+
 static void
 show_directory (avt_color markcolor)
 {
@@ -108,13 +147,16 @@ show_directory (avt_color markcolor)
 #  define FILTER_DIRENT_T  struct dirent
 #endif
 
+// directories always pass, the filter only gets other files
+// without a filter there is no need for a stat
 static int
 filter_dirent (FILTER_DIRENT_T * d, avt_filter filter, void *filter_data)
 {
   // allow nothing that starts with a dot
   if (not d or d->d_name[0] == '.')
     return false;
-  else if (not filter or is_dirent_directory (d))
+  else if (not filter or dirent_type (d) == FC_DIRECTORY
+	   or (dirent_type (d) == FC_UNKNOWN and is_directory (d->d_name)))
     return true;
   else
     return filter (d->d_name, filter_data);
@@ -128,7 +170,7 @@ filter_dirent (const struct dirent *d, avt_filter filter, void *filter_data)
   // don't allow "." and ".." and apply filter
   if (not d or strcmp (".", d->d_name) == 0 or strcmp ("..", d->d_name) == 0)
     return false;
-  else if (not filter or is_dirent_directory (d))
+  else if (not filter or is_directory (d->d_name))
     return true;
   else
     return filter (d->d_name, filter_data);
@@ -180,84 +222,204 @@ ask_directory (avt_color markcolor)
     }
 }
 
+// for qsort, which has no parameter for the data
+static const char *sort_arena;
+
 static int
-compare_dirent (const void *a, const void *b)
+compare_entry (const void *a, const void *b)
 {
-  return strcoll ((*(struct dirent **) a)->d_name,
-		  (*(struct dirent **) b)->d_name);
+  return strcmp (sort_arena + ((const struct fc_entry *) a)->key,
+		 sort_arena + ((const struct fc_entry *) b)->key);
+}
+
+// returns the offset of the copy or (size_t) -1 on error
+static size_t
+arena_add (struct fc_directory *dir, const char *s, size_t size)
+{
+  size_t offset;
+
+  if (dir->arena_size + size > dir->arena_capacity)
+    {
+      size_t capacity;
+      char *arena;
+
+      capacity = dir->arena_capacity ? 2 * dir->arena_capacity : 16384;
+      while (dir->arena_size + size > capacity)
+	capacity *= 2;
+
+      arena = (char *) realloc (dir->arena, capacity);
+      if (not arena)
+	return (size_t) -1;
+
+      dir->arena = arena;
+      dir->arena_capacity = capacity;
+    }
+
+  offset = dir->arena_size;
+  if (s)
+    memcpy (dir->arena + offset, s, size);
+  dir->arena_size += size;
+
+  return offset;
+}
+
+static void
+free_directory (struct fc_directory *dir)
+{
+  free (dir->entries);
+  free (dir->arena);
+  memset (dir, 0, sizeof (*dir));
+}
+
+// the collation keys make sorting much faster than strcoll
+static bool
+collation_keys (struct fc_directory *dir)
+{
+  for (int i = 0; i < dir->count; i++)
+    {
+      struct fc_entry *e = &dir->entries[i];
+      size_t size;
+
+      size = strxfrm (NULL, dir->arena + e->name, 0) + 1;
+      e->key = arena_add (dir, NULL, size);
+
+      if (e->key == (size_t) -1)
+	return false;
+
+      strxfrm (dir->arena + e->key, dir->arena + e->name, size);
+    }
+
+  return true;
 }
 
 static int
-get_directory (struct dirent ***list, avt_filter filter, void *filter_data)
+get_directory (struct fc_directory *dir, avt_filter filter,
+	       void *filter_data)
 {
-  int max_entries;
-  struct dirent **mylist;
   struct dirent *d;
-  int entries;
-  DIR *dir;
+  DIR *directory;
 
-  *list = NULL;
-  mylist = NULL;
-  entries = max_entries = 0;
+  memset (dir, 0, sizeof (*dir));
 
-  dir = opendir (".");
-  if (not dir)
+  directory = opendir (".");
+  if (not directory)
     return -1;
 
-  while ((d = readdir (dir)))
+  while ((d = readdir (directory)))
     {
+      if (not filter_dirent (d, filter, filter_data))
+	continue;
+
       // need more memory?
-      if (entries >= max_entries)
+      if (dir->count >= dir->capacity)
 	{
-	  struct dirent **tmp;
+	  struct fc_entry *tmp;
+	  int capacity;
 
-	  if (max_entries > 0)
-	    max_entries *= 2;
-	  else
-	    max_entries = 10;
-
-	  tmp = (struct dirent **)
-	    realloc (mylist, max_entries * sizeof (struct dirent *));
+	  capacity = dir->capacity ? 2 * dir->capacity : 256;
+	  tmp = (struct fc_entry *)
+	    realloc (dir->entries, capacity * sizeof (struct fc_entry));
 
 	  if (not tmp)
-	    {
-	      while (entries--)
-		free (mylist[entries]);
+	    break;
 
-	      free (mylist);
-	      closedir (dir);
+	  dir->entries = tmp;
+	  dir->capacity = capacity;
+	}
 
-	      return -1;
-	    }
+      struct fc_entry *e = &dir->entries[dir->count];
 
-	  mylist = tmp;
-	}
+      e->name = arena_add (dir, d->d_name, strlen (d->d_name) + 1);
+      if (e->name == (size_t) -1)
+	break;
 
-      if (filter_dirent (d, filter, filter_data))
-	{
-	  struct dirent *n;
+      e->key = e->name;
+      e->type = dirent_type (d);
+      dir->count++;
+    }
 
-	  n = (struct dirent *) malloc (sizeof (struct dirent));
+  closedir (directory);
 
-	  if (not n)
-	    break;
+  // sort
+  if (dir->count > 1)
+    {
+      if (not collation_keys (dir))	// fall back to the names
+	for (int i = 0; i < dir->count; i++)
+	  dir->entries[i].key = dir->entries[i].name;
+
+      sort_arena = dir->arena;
+      qsort (dir->entries, dir->count, sizeof (struct fc_entry),
+	     compare_entry);
+      sort_arena = NULL;
+    }
 
-	  memcpy (n, d, sizeof (struct dirent));
-	  mylist[entries++] = n;
-	}
+  return dir->count;
+}
+
+/*
+ * type-ahead: binary search for the prefix in the sorted entries
+ * returns the menu item or 0
+ */
+static int
+search (const wchar_t * prefix, void *fc_data)
+{
+  struct avt_fc_data *data = fc_data;
+  struct fc_directory *dir = &data->dir;
+  const struct avt_charenc *encoding;
+  char name[4 * AVT_LINELENGTH + 1];
+  size_t length, key_size;
+  int low, high;
+
+  // the names are in the current encoding
+  encoding = avt_char_encoding (NULL);
+  length = 0;
+
+  for (; *prefix; prefix++)
+    {
+      char bytes[8];
+      size_t size;
+
+      size = encoding->encode (encoding, bytes, sizeof (bytes), *prefix);
+      if (not size or length + size >= sizeof (name))
+	return 0;
+
+      memcpy (name + length, bytes, size);
+      length += size;
     }
 
-  // sort
-  if (mylist)
-    qsort (mylist, entries, sizeof (struct dirent *), compare_dirent);
+  name[length] = '\0';
 
-  closedir (dir);
+  if (not dir->count)
+    return 0;
 
-  if (not mylist)
-    return -1;
+  key_size = strxfrm (NULL, name, 0) + 1;
+  char key[key_size];
+  strxfrm (key, name, key_size);
+
+  // first entry not before the prefix
+  low = 0;
+  high = dir->count;
+
+  while (low < high)
+    {
+      int middle = low + (high - low) / 2;
+
+      if (strcmp (dir->arena + dir->entries[middle].key, key) < 0)
+	low = middle + 1;
+      else
+	high = middle;
+    }
+
+  if (low < dir->count
+      and strncasecmp (entry_name (dir, low), name, length) == 0)
+    return low + 3;
+
+  // the collation may order it differently
+  for (int i = 0; i < dir->count; i++)
+    if (strncasecmp (entry_name (dir, i), name, length) == 0)
+      return i + 3;
 
-  *list = mylist;
-  return entries;
+  return 0;
 }
 
 // show entry nr
@@ -273,13 +435,12 @@ show (int nr, void *fc_data)
     marked_text (PARENT_DIRECTORY, markcolor);
   else
     {
-      struct dirent *d = data->namelist[nr - 3];
       int max_x = avt_get_max_x ();
 
-      avt_say_char (d->d_name);
+      avt_say_char (entry_name (&data->dir, nr - 3));
 
       // is it a directory?
-      if (is_dirent_directory (d))
+      if (is_entry_directory (&data->dir, nr - 3))
 	{
 	  // mark as directory
 	  if (avt_where_x () > max_x - 1)
@@ -331,7 +492,7 @@ avt_file_selection (char *filename, int filename_size,
   else
     data.markcolor = avt_brighter (data.markcolor, 0x88);
 
-  data.namelist = NULL;
+  memset (&data.dir, 0, sizeof (data.dir));
 
   // don't show the balloon
   avt_show_avatar ();
@@ -341,13 +502,13 @@ avt_file_selection (char *filename, int filename_size,
 
   while (rcode < 0)
     {
-      entries = get_directory (&data.namelist, filter, filter_data);
+      entries = get_directory (&data.dir, filter, filter_data);
       if (entries < 0)
 	break;
 
       avt_move_xy (1, 1);
       // entry 1 is directory name, entry 2 is parent directory
-      if (avt_menu (&choice, entries + 2, show, &data))
+      if (avt_menu_search (&choice, entries + 2, show, search, &data))
 	break;
 
       if (1 == choice)		// path
@@ -366,34 +527,24 @@ avt_file_selection (char *filename, int filename_size,
 	}
       else			// normal entry
 	{
-	  struct dirent *d = data.namelist[choice - 3];
+	  const char *name = entry_name (&data.dir, choice - 3);
 
-	  if (is_dirent_directory (d))
+	  if (is_entry_directory (&data.dir, choice - 3))
 	    {
-	      if (chdir (d->d_name))
+	      if (chdir (name))
 		avt_bell ();
 	    }
-	  else if (strlen (d->d_name) < (size_t) filename_size)
+	  else if (strlen (name) < (size_t) filename_size)
 	    {
-	      strcpy (filename, d->d_name);
+	      strcpy (filename, name);
 	      rcode = 0;	// found
 	    }
 	}
 
-      // free namelist
-      while (entries--)
-	free (data.namelist[entries]);
-      free (data.namelist);
-      data.namelist = NULL;
+      free_directory (&data.dir);
     }
 
-  if (data.namelist)
-    {
-      while (entries--)
-	free (data.namelist[entries]);
-      free (data.namelist);
-      data.namelist = NULL;
-    }
+  free_directory (&data.dir);
 
   avt_char_encoding (old_encoding);
 
@@ -57,6 +57,7 @@ typedef struct graphic
   short int width, height;
   short int thickness;		// thickness of pen
   short int htextalign, vtextalign;	// alignment for text
+  short int dirty_x1, dirty_y1, dirty_x2, dirty_y2;	// changed area
   double penx, peny;		// position of pen
   double heading;		// heading of the turtle
   avt_color color;		// drawing color
@@ -136,6 +137,37 @@ visible (graphic * gr, int x, int y)
   return (x >= 0 and x < gr->width and y >= 0 and y < gr->height);
 }
 
+// extend the changed area, the coordinates must be visible
+static inline void
+dirty (graphic * gr, int x1, int y1, int x2, int y2)
+{
+  if (x1 < gr->dirty_x1)
+    gr->dirty_x1 = x1;
+  if (y1 < gr->dirty_y1)
+    gr->dirty_y1 = y1;
+  if (x2 > gr->dirty_x2)
+    gr->dirty_x2 = x2;
+  if (y2 > gr->dirty_y2)
+    gr->dirty_y2 = y2;
+}
+
+static inline void
+dirty_all (graphic * gr)
+{
+  gr->dirty_x1 = gr->dirty_y1 = 0;
+  gr->dirty_x2 = gr->width - 1;
+  gr->dirty_y2 = gr->height - 1;
+}
+
+// nothing changed since it was shown
+static inline void
+dirty_none (graphic * gr)
+{
+  gr->dirty_x1 = gr->width;
+  gr->dirty_y1 = gr->height;
+  gr->dirty_x2 = gr->dirty_y2 = -1;
+}
+
 // set pen position
 static inline void
 penpos (graphic * gr, int x, int y)
@@ -151,18 +183,12 @@ center (graphic * gr)
   gr->peny = ((double) gr->height) / 2.0 - 1.0;
 }
 
-// fast putpixel with color, no check
-static inline void
-putpixelcolor (graphic * gr, int x, int y, int width, avt_color col)
-{
-  *(gr->data + (y * width) + x) = col;
-}
-
 // fast putpixel, no check
 static inline void
 putpixel (graphic * gr, int x, int y)
 {
   *(gr->data + (y * gr->width) + x) = gr->color;
+  dirty (gr, x, y, x, y);
 }
 
 static inline bool
@@ -183,6 +209,8 @@ clear_graphic (graphic * gr)
 
   for (size_t i = gr->width * gr->height; i > 0; i--)
     *p++ = color;
+
+  dirty_all (gr);
 }
 
 
@@ -211,51 +239,101 @@ bar (graphic * gr, int x1, int y1, int x2, int y2)
       for (x = x1; x <= x2; x++)
 	*p++ = color;
     }
+
+  dirty (gr, x1, y1, x2, y2);
 }
 
 
+// fill an area, clipped to the graphic
 static void
-disc (graphic * gr, double x, double y, double radius)
+area (graphic * gr, int x1, int y1, int x2, int y2)
 {
-  int width, height;
-  int x1, y1, x2, y2;
-  int i;
-  double xv, yv;
-  double r2;
-  avt_color *data, *p;
+  int width;
+  avt_color *p;
   avt_color color;
 
   width = gr->width;
-  height = gr->height;
+
+  if (x1 < 0)
+    x1 = 0;
+  if (y1 < 0)
+    y1 = 0;
+  if (x2 >= width)
+    x2 = width - 1;
+  if (y2 >= gr->height)
+    y2 = gr->height - 1;
+
+  if (x1 > x2 or y1 > y2)
+    return;
+
   color = gr->color;
-  data = gr->data;
-  r2 = radius * radius;
 
-  for (yv = 0.0; yv <= radius; yv++)
+  for (int y = y1; y <= y2; y++)
     {
-      xv = sqrt (r2 - (yv * yv));
-
-      x1 = (int) (x - xv);
-      y1 = (int) (y - yv);
-      x2 = (int) (x + xv);
-      y2 = (int) (y + yv);
-
-      // sanitize values
-      x1 = RANGE (x1, 0, width - 1);
-      y1 = RANGE (y1, 0, height - 1);
-      x2 = RANGE (x2, 0, width - 1);
-      y2 = RANGE (y2, 0, height - 1);
-
-      // upper half
-      p = data + (y1 * width) + x1;
-      for (i = x1; i <= x2; i++)
-	*p++ = color;
+      p = gr->data + (y * width) + x1;
 
-      // lower half
-      p = data + (y2 * width) + x1;
-      for (i = x1; i <= x2; i++)
+      for (int x = x1; x <= x2; x++)
 	*p++ = color;
     }
+
+  dirty (gr, x1, y1, x2, y2);
+}
+
+
+// is the value usable as a coordinate?
+static inline bool
+coordinate (double v)
+{
+  return (isfinite (v) and fabs (v) < (INT_MAX / 4));
+}
+
+
+// midpoint circle algorithm, every line is filled once
+static void
+disc (graphic * gr, double x, double y, double radius)
+{
+  int cx, cy, r, dx, dy, d;
+
+  if (not coordinate (x) or not coordinate (y) or not coordinate (radius)
+      or radius < 0.0)
+    return;
+
+  cx = (int) floor (x);
+  cy = (int) floor (y);
+  r = (int) radius;
+
+  // completely outside?
+  if (cx + r < 0 or cx - r >= gr->width or cy + r < 0
+      or cy - r >= gr->height)
+    return;
+
+  dx = r;
+  dy = 0;
+  d = 1 - r;
+
+  while (dy <= dx)
+    {
+      area (gr, cx - dx, cy + dy, cx + dx, cy + dy);
+      if (dy != 0)
+	area (gr, cx - dx, cy - dy, cx + dx, cy - dy);
+
+      if (d < 0)
+	d += 2 * dy + 3;
+      else
+	{
+	  // the outer lines get their final width
+	  if (dx != dy)
+	    {
+	      area (gr, cx - dy, cy + dx, cx + dy, cy + dx);
+	      area (gr, cx - dy, cy - dx, cx + dy, cy - dx);
+	    }
+
+	  d += 2 * (dy - dx) + 5;
+	  dx--;
+	}
+
+      dy++;
+    }
 }
 
 
@@ -316,6 +394,39 @@ lgraphic_new (lua_State * L)
 }
 
 
+// local gr, width, height = graphic.screenshot()
+static int
+lgraphic_screenshot (lua_State * L)
+{
+  int width, height;
+  graphic *gr;
+
+  width = avt_image_max_width ();
+  height = avt_image_max_height ();
+
+  gr = new_graphic (L, graphic_bytes (width, height));
+  gr->width = width;
+  gr->height = height;
+  gr->color = 0x000000;
+  center (gr);
+  gr->thickness = 1 - 1;
+  gr->htextalign = HA_CENTER;
+  gr->vtextalign = VA_CENTER;
+  gr->heading = 0.0;
+  gr->background = avt_get_background_color ();
+
+  if (avt_screenshot_raw (gr->data, width, height) == AVT_FAILURE)
+    return luaL_error (L, "%s", avt_get_error ());
+
+  dirty_all (gr);
+
+  lua_pushinteger (L, width);
+  lua_pushinteger (L, height);
+
+  return 3;
+}
+
+
 static int
 lgraphic_fullsize (lua_State * L)
 {
@@ -490,179 +601,298 @@ lgraphic_center (lua_State * L)
 static void
 vertical_line (graphic * gr, int x, int y1, int y2)
 {
-  if (visible_x (gr, x))
+  int s = gr->thickness;
+
+  if (y1 > y2)			// swap
     {
-      if (y1 > y2)		// swap
+      int ty = y1;
+      y1 = y2;
+      y2 = ty;
+    }
+
+  area (gr, x - s, y1 - s, x + s, y2 + s);
+}
+
+
+static void
+horizontal_line (graphic * gr, int x1, int x2, int y)
+{
+  int s = gr->thickness;
+
+  if (x1 > x2)			// swap
+    {
+      int tx = x1;
+      x1 = x2;
+      x2 = tx;
+    }
+
+  area (gr, x1 - s, y - s, x2 + s, y + s);
+}
+
+
+// region codes for the Cohen-Sutherland algorithm
+#define CLIP_LEFT    1
+#define CLIP_RIGHT   2
+#define CLIP_TOP     4
+#define CLIP_BOTTOM  8
+
+static inline int
+clip_code (double x, double y, double xmin, double ymin,
+	   double xmax, double ymax)
+{
+  int code = 0;
+
+  if (x < xmin)
+    code = CLIP_LEFT;
+  else if (x > xmax)
+    code = CLIP_RIGHT;
+
+  if (y < ymin)
+    code |= CLIP_TOP;
+  else if (y > ymax)
+    code |= CLIP_BOTTOM;
+
+  return code;
+}
+
+
+// clip the line to the rectangle
+// returns false, when nothing is left
+static bool
+clip_line (double *x1, double *y1, double *x2, double *y2,
+	   double xmin, double ymin, double xmax, double ymax)
+{
+  int code1, code2;
+
+  if (not coordinate (*x1) or not coordinate (*y1)
+      or not coordinate (*x2) or not coordinate (*y2))
+    return false;
+
+  code1 = clip_code (*x1, *y1, xmin, ymin, xmax, ymax);
+  code2 = clip_code (*x2, *y2, xmin, ymin, xmax, ymax);
+
+  while (code1 bitor code2)
+    {
+      int code;
+      double x, y;
+
+      // both on the same outer side?
+      if (code1 bitand code2)
+	return false;
+
+      code = code1 ? code1 : code2;
+
+      if (code bitand CLIP_TOP)
 	{
-	  int ty = y1;
-	  y1 = y2;
-	  y2 = ty;
+	  x = *x1 + (*x2 - *x1) * (ymin - *y1) / (*y2 - *y1);
+	  y = ymin;
+	}
+      else if (code bitand CLIP_BOTTOM)
+	{
+	  x = *x1 + (*x2 - *x1) * (ymax - *y1) / (*y2 - *y1);
+	  y = ymax;
+	}
+      else if (code bitand CLIP_RIGHT)
+	{
+	  y = *y1 + (*y2 - *y1) * (xmax - *x1) / (*x2 - *x1);
+	  x = xmax;
+	}
+      else			// CLIP_LEFT
+	{
+	  y = *y1 + (*y2 - *y1) * (xmin - *x1) / (*x2 - *x1);
+	  x = xmin;
 	}
 
-      int height = gr->height;
-      y1 = RANGE (y1, 0, height - 1);
-      y2 = RANGE (y2, 0, height - 1);
-
-      if (gr->thickness > 0)
+      if (code == code1)
 	{
-	  for (int y = y1; y <= y2; y++)
-	    putdot (gr, x, y);
+	  *x1 = x;
+	  *y1 = y;
+	  code1 = clip_code (x, y, xmin, ymin, xmax, ymax);
 	}
       else
 	{
-	  avt_color color = gr->color;
-	  int width = gr->width;
-
-	  for (int y = y1; y <= y2; y++)
-	    if (visible_y (gr, y))
-	      putpixelcolor (gr, x, y, width, color);
+	  *x2 = x;
+	  *y2 = y;
+	  code2 = clip_code (x, y, xmin, ymin, xmax, ymax);
 	}
     }
+
+  return true;
+}
+
+
+/*
+ * sloped lines are stepped with fixed point numbers,
+ * so the start and end points keep their fractional positions
+ */
+typedef int_least64_t fixed;
+
+#define FIXED_ONE  ((fixed) 1 << 32)
+
+// conversion truncates towards zero
+static inline fixed
+to_fixed (double v)
+{
+  return (fixed) (v * FIXED_ONE);
 }
 
+static inline int
+fixed_floor (fixed v)
+{
+  fixed q = v / FIXED_ONE;
+
+  if (v % FIXED_ONE < 0)
+    q--;
 
+  return (int) q;
+}
+
+
+// the line must be completely visible
 static void
-horizontal_line (graphic * gr, int x1, int x2, int y)
+thin_line (graphic * gr, double x1, double y1, double x2, double y2)
 {
-  if (visible_y (gr, y))
+  int width, steps;
+  fixed v, delta;
+  avt_color *p;
+  avt_color color;
+
+  width = gr->width;
+  color = gr->color;
+
+  // one pixel more for rounding errors
+  dirty (gr, RANGE ((int) fmin (x1, x2) - 1, 0, width - 1),
+	 RANGE ((int) fmin (y1, y2) - 1, 0, gr->height - 1),
+	 RANGE ((int) fmax (x1, x2) + 1, 0, width - 1),
+	 RANGE ((int) fmax (y1, y2) + 1, 0, gr->height - 1));
+
+  if (fabs (x2 - x1) >= fabs (y2 - y1))	// x steps 1
     {
-      if (x1 > x2)		// swap
+      if (x1 > x2)		// swap start and end point
 	{
-	  int tx = x1;
+	  double t;
+
+	  t = x1;
 	  x1 = x2;
-	  x2 = tx;
+	  x2 = t;
+
+	  t = y1;
+	  y1 = y2;
+	  y2 = t;
 	}
 
-      int width = gr->width;
-      x1 = RANGE (x1, 0, width - 1);
-      x2 = RANGE (x2, 0, width - 1);
+      steps = (int) (x2 - x1);
+      v = to_fixed (y1);
+      delta = to_fixed ((y2 - y1) / (x2 - x1));
+      p = gr->data + (int) x1;
 
-      if (gr->thickness > 0)
-	{
-	  for (int x = x1; x <= x2; x++)
-	    putdot (gr, x, y);
-	}
-      else
+      for (int i = 0; i <= steps; i++, v += delta)
+	p[fixed_floor (v) * width + i] = color;
+    }
+  else				// y steps 1
+    {
+      if (y1 > y2)		// swap start and end point
 	{
-	  avt_color *p;
-	  avt_color color;
+	  double t;
 
-	  color = gr->color;
-	  p = gr->data + (y * width) + x1;
+	  t = x1;
+	  x1 = x2;
+	  x2 = t;
 
-	  for (int x = x1; x <= x2; x++)
-	    *p++ = color;
+	  t = y1;
+	  y1 = y2;
+	  y2 = t;
 	}
+
+      steps = (int) (y2 - y1);
+      v = to_fixed (x1);
+      delta = to_fixed ((x2 - x1) / (y2 - y1));
+      p = gr->data + ((int) y1 * width);
+
+      for (int i = 0; i <= steps; i++, v += delta, p += width)
+	p[fixed_floor (v)] = color;
     }
 }
 
 
+/*
+ * thick line as union of the squares of the pen,
+ * drawn as spans in the direction of the minor axis
+ */
 static void
-sloped_line (graphic * gr, double x1, double x2, double y1, double y2)
+thick_line (graphic * gr, double x1, double y1, double x2, double y2)
 {
-  double dx, dy;
+  int s, start, steps, first, last;
+  fixed v, delta;
 
-  dx = fabs (x2 - x1);
-  dy = fabs (y2 - y1);
+  s = gr->thickness;
 
-  if (dx > dy)			// x steps 1
+  if (fabs (x2 - x1) >= fabs (y2 - y1))	// vertical spans
     {
-      double delta_y;
-
       if (x1 > x2)		// swap start and end point
 	{
-	  double tx, ty;
+	  double t;
 
-	  tx = x1;
+	  t = x1;
 	  x1 = x2;
-	  x2 = tx;
+	  x2 = t;
 
-	  ty = y1;
+	  t = y1;
 	  y1 = y2;
-	  y2 = ty;
+	  y2 = t;
 	}
 
-      dy = y2 - y1;
-      delta_y = dy / dx;
-
-      // sanitize range of x
-      if (x1 < 0.0)
-	{
-	  y1 -= delta_y * x1;
-	  x1 = 0.0;
-	}
+      start = (int) floor (x1);
+      steps = (int) (x2 - x1);
+      v = to_fixed (y1);
+      delta = to_fixed ((y2 - y1) / (x2 - x1));
 
-      if (x2 >= gr->width)
-	x2 = gr->width - 1.0;
+      first = avt_max (start - s, 0);
+      last = avt_min (start + steps + s, gr->width - 1);
 
-      if (gr->thickness > 0)
+      for (int x = first; x <= last; x++)
 	{
-	  double x, y;
+	  int a, b;
 
-	  for (x = x1, y = y1; x <= x2; x++, y += delta_y)
-	    putdot (gr, x, y);
-	}
-      else
-	{
-	  double x, y;
-	  avt_color color = gr->color;
-	  int width = gr->width;
+	  // the first and last pen position covering this column
+	  a = fixed_floor (v + avt_max (x - s - start, 0) * delta);
+	  b = fixed_floor (v + avt_min (x + s - start, steps) * delta);
 
-	  for (x = x1, y = y1; x <= x2; x++, y += delta_y)
-	    {
-	      if (visible_y (gr, y))
-		putpixelcolor (gr, x, y, width, color);
-	    }
+	  area (gr, x, avt_min (a, b) - s, x, avt_max (a, b) + s);
 	}
     }
-  else				// y steps 1
+  else				// horizontal spans
     {
-      double delta_x;
-
       if (y1 > y2)		// swap start and end point
 	{
-	  double tx, ty;
+	  double t;
 
-	  tx = x1;
+	  t = x1;
 	  x1 = x2;
-	  x2 = tx;
+	  x2 = t;
 
-	  ty = y1;
+	  t = y1;
 	  y1 = y2;
-	  y2 = ty;
+	  y2 = t;
 	}
 
-      dx = x2 - x1;
-      delta_x = dx / dy;
+      start = (int) floor (y1);
+      steps = (int) (y2 - y1);
+      v = to_fixed (x1);
+      delta = to_fixed ((x2 - x1) / (y2 - y1));
 
-      // sanitize range of y
-      if (y1 < 0.0)
-	{
-	  x1 -= delta_x * y1;
-	  y1 = 0.0;
-	}
-
-      if (y2 >= gr->height)
-	y2 = gr->height - 1.0;
+      first = avt_max (start - s, 0);
+      last = avt_min (start + steps + s, gr->height - 1);
 
-      if (gr->thickness > 0)
+      for (int y = first; y <= last; y++)
 	{
-	  double x, y;
+	  int a, b;
 
-	  for (y = y1, x = x1; y <= y2; y++, x += delta_x)
-	    putdot (gr, x, y);
-	}
-      else
-	{
-	  double x, y;
-	  avt_color color = gr->color;
-	  int width = gr->width;
+	  // the first and last pen position covering this line
+	  a = fixed_floor (v + avt_max (y - s - start, 0) * delta);
+	  b = fixed_floor (v + avt_min (y + s - start, steps) * delta);
 
-	  for (y = y1, x = x1; y <= y2; y++, x += delta_x)
-	    {
-	      if (visible_x (gr, x))
-		putpixelcolor (gr, x, y, width, color);
-	    }
+	  area (gr, avt_min (a, b) - s, y, avt_max (a, b) + s, y);
 	}
     }
 }
@@ -672,23 +902,26 @@ static void
 line (graphic * gr, double x1, double y1, double x2, double y2)
 {
   int ix1, iy1, ix2, iy2;
+  int s = gr->thickness;
 
-  ix1 = (int) x1;
-  iy1 = (int) y1;
-  ix2 = (int) x2;
-  iy2 = (int) y2;
+  // a thick pen reaches into the graphic from outside
+  if (not clip_line (&x1, &y1, &x2, &y2, -s, -s,
+		     gr->width - 1 + s, gr->height - 1 + s))
+    return;
 
-  if (ix1 == ix2 and iy1 == iy2)	// one dot
-    {
-      if (visible (gr, ix1, iy1))
-	putdot (gr, ix1, iy1);
-    }
-  else if (ix1 == ix2)
+  ix1 = (int) floor (x1);
+  iy1 = (int) floor (y1);
+  ix2 = (int) floor (x2);
+  iy2 = (int) floor (y2);
+
+  if (ix1 == ix2)
     vertical_line (gr, ix1, iy1, iy2);
   else if (iy1 == iy2)
     horizontal_line (gr, ix1, ix2, iy1);
+  else if (s > 0)
+    thick_line (gr, x1, y1, x2, y2);
   else
-    sloped_line (gr, x1, x2, y1, y2);
+    thin_line (gr, x1, y1, x2, y2);
 }
 
 
@@ -750,6 +983,205 @@ lgraphic_linerel (lua_State * L)
 }
 
 
+/*
+ * coordinates in tables for batched drawing
+ * either flat {x1, y1, x2, y2, ...} or nested {{x1, y1}, {x2, y2}, ...}
+ */
+
+static double
+table_number (lua_State * L, int table, int index, int arg)
+{
+  double v;
+  int isnum;
+
+  lua_rawgeti (L, table, index);
+  v = lua_tonumberx (L, -1, &isnum);
+  lua_pop (L, 1);
+
+  if (not isnum)
+    luaL_argerror (L, arg, "table with numbers expected");
+
+  return v;
+}
+
+static inline bool
+nested_table (lua_State * L, int table)
+{
+  bool nested;
+
+  lua_rawgeti (L, table, 1);
+  nested = lua_istable (L, -1);
+  lua_pop (L, 1);
+
+  return nested;
+}
+
+// number of items with n values each
+static int
+table_items (lua_State * L, int table, bool nested, int n)
+{
+  size_t len = lua_rawlen (L, table);
+
+  if (not nested)
+    len /= n;
+
+  return (len < INT_MAX) ? (int) len : INT_MAX;
+}
+
+// get n values of item nr (counting from 1)
+static void
+table_item (lua_State * L, int table, bool nested, int nr, int n, double *v)
+{
+  if (nested)
+    {
+      lua_rawgeti (L, table, nr);
+
+      if (not lua_istable (L, -1))
+	luaL_argerror (L, table, "table with tables expected");
+
+      for (int i = 0; i < n; i++)
+	v[i] = table_number (L, lua_gettop (L), i + 1, table);
+
+      lua_pop (L, 1);
+    }
+  else
+    for (int i = 0; i < n; i++)
+      v[i] = table_number (L, table, (nr - 1) * n + i + 1, table);
+}
+
+
+// gr:polyline (points)
+static int
+lgraphic_polyline (lua_State * L)
+{
+  graphic *gr;
+  bool nested;
+  int count;
+  double p[2], x, y;
+
+  gr = get_graphic (L, 1);
+  luaL_checktype (L, 2, LUA_TTABLE);
+
+  nested = nested_table (L, 2);
+  count = table_items (L, 2, nested, 2);
+
+  if (count < 1)
+    return 0;
+
+  table_item (L, 2, nested, 1, 2, p);
+  x = p[0] - 1.0;
+  y = p[1] - 1.0;
+
+  if (count == 1)
+    line (gr, x, y, x, y);
+
+  for (int i = 2; i <= count; i++)
+    {
+      double nx, ny;
+
+      table_item (L, 2, nested, i, 2, p);
+      nx = p[0] - 1.0;
+      ny = p[1] - 1.0;
+
+      line (gr, x, y, nx, ny);
+      x = nx;
+      y = ny;
+    }
+
+  penpos (gr, x, y);
+
+  return 0;
+}
+
+
+// gr:points (points)
+// gr:points (xs, ys)
+static int
+lgraphic_points (lua_State * L)
+{
+  graphic *gr;
+  int count;
+  bool nested, separate;
+
+  gr = get_graphic (L, 1);
+  luaL_checktype (L, 2, LUA_TTABLE);
+
+  separate = not lua_isnoneornil (L, 3);
+
+  if (separate)
+    {
+      luaL_checktype (L, 3, LUA_TTABLE);
+      nested = false;
+      count = avt_min (table_items (L, 2, false, 1),
+		       table_items (L, 3, false, 1));
+    }
+  else
+    {
+      nested = nested_table (L, 2);
+      count = table_items (L, 2, nested, 2);
+    }
+
+  for (int i = 1; i <= count; i++)
+    {
+      double p[2];
+      int x, y;
+
+      if (separate)
+	{
+	  p[0] = table_number (L, 2, i, 2);
+	  p[1] = table_number (L, 3, i, 3);
+	}
+      else
+	table_item (L, 2, nested, i, 2, p);
+
+      if (not coordinate (p[0]) or not coordinate (p[1]))
+	continue;
+
+      x = (int) p[0] - 1;
+      y = (int) p[1] - 1;
+
+      if (visible (gr, x, y))
+	{
+	  if (gr->thickness > 0)
+	    putdot (gr, x, y);
+	  else
+	    putpixel (gr, x, y);
+	}
+    }
+
+  return 0;
+}
+
+
+// gr:bars (bars)
+static int
+lgraphic_bars (lua_State * L)
+{
+  graphic *gr;
+  int count;
+  bool nested;
+
+  gr = get_graphic (L, 1);
+  luaL_checktype (L, 2, LUA_TTABLE);
+
+  nested = nested_table (L, 2);
+  count = table_items (L, 2, nested, 4);
+
+  for (int i = 1; i <= count; i++)
+    {
+      double b[4];
+
+      table_item (L, 2, nested, i, 4, b);
+
+      if (coordinate (b[0]) and coordinate (b[1])
+	  and coordinate (b[2]) and coordinate (b[3]))
+	bar (gr, b[0] - 1.0, b[1] - 1.0, b[2] - 1.0, b[3] - 1.0);
+    }
+
+  return 0;
+}
+
+
 // gr:putpixel ([x, y])
 static int
 lgraphic_putpixel (lua_State * L)
@@ -944,6 +1376,83 @@ lgraphic_border3d (lua_State * L)
   return 0;
 }
 
+// is the point in the sector from s to e (clockwise)?
+static inline bool
+in_sector (int x, int y, double sx, double sy, double ex, double ey,
+	   bool wide)
+{
+  double c1, c2;
+
+  c1 = sx * y - sy * x;		// positive: clockwise from s
+  c2 = x * ey - y * ex;		// positive: counterclockwise from e
+
+  if (wide)			// more than 180 degrees
+    return (c1 >= 0.0 or c2 >= 0.0);
+  else
+    return (c1 >= 0.0 and c2 >= 0.0);
+}
+
+
+static inline void
+arc_point (graphic * gr, int x, int y)
+{
+  if (visible (gr, x, y))
+    putpixel (gr, x, y);
+}
+
+
+// thin arc with the midpoint circle algorithm
+static void
+thin_arc (graphic * gr, double radius, double startangle, double endangle)
+{
+  int cx, cy, r, dx, dy, d;
+  double sx, sy, ex, ey;
+  bool full, wide;
+
+  if (not coordinate (gr->penx) or not coordinate (gr->peny)
+      or not coordinate (radius) or radius < 0.0)
+    return;
+
+  cx = (int) floor (gr->penx);
+  cy = (int) floor (gr->peny);
+  r = (int) radius;
+
+  full = (endangle - startangle >= 360.0);
+  wide = (endangle - startangle > 180.0);
+
+  // directions of the ends (0 degrees is up)
+  sx = sin (radians (startangle));
+  sy = -cos (radians (startangle));
+  ex = sin (radians (endangle));
+  ey = -cos (radians (endangle));
+
+  dx = r;
+  dy = 0;
+  d = 1 - r;
+
+  while (dy <= dx)
+    {
+      // all 8 octants
+      int px[8] = { dx, dx, -dx, -dx, dy, dy, -dy, -dy };
+      int py[8] = { dy, -dy, dy, -dy, dx, -dx, dx, -dx };
+
+      for (int i = 0; i < 8; i++)
+	if (full or in_sector (px[i], py[i], sx, sy, ex, ey, wide))
+	  arc_point (gr, cx + px[i], cy + py[i]);
+
+      if (d < 0)
+	d += 2 * dy + 3;
+      else
+	{
+	  d += 2 * (dy - dx) + 5;
+	  dx--;
+	}
+
+      dy++;
+    }
+}
+
+
 // gr:arc (radius [,angle1] [,angle2])
 static int
 lgraphic_arc (lua_State * L)
@@ -975,6 +1484,13 @@ lgraphic_arc (lua_State * L)
   while (startangle > endangle)
     endangle += 360;
 
+  if (gr->thickness <= 0)
+    {
+      thin_arc (gr, radius, startangle, endangle);
+      return 0;
+    }
+
+  // thick arcs are made of lines
   xcenter = gr->penx;
   ycenter = gr->peny;
 
@@ -1021,6 +1537,7 @@ lgraphic_show (lua_State * L)
   shown_height = gr->height;
 
   status = avt_show_raw_image (&gr->data, shown_width, shown_height);
+  dirty_none (gr);
 
   if (status <= AVT_ERROR)
     {
@@ -1038,6 +1555,54 @@ lgraphic_show (lua_State * L)
 }
 
 
+// gr:show_region ([x, y, width, height])
+// without values it shows the area changed since the last show
+static int
+lgraphic_show_region (lua_State * L)
+{
+  graphic *gr;
+  int x, y, width, height;
+  int status;
+
+  gr = get_graphic (L, 1);
+
+  if (lua_isnoneornil (L, 2))
+    {
+      x = gr->dirty_x1;
+      y = gr->dirty_y1;
+      width = gr->dirty_x2 - gr->dirty_x1 + 1;
+      height = gr->dirty_y2 - gr->dirty_y1 + 1;
+      dirty_none (gr);
+    }
+  else
+    {
+      x = luaL_checknumber (L, 2) - 1.0;
+      y = luaL_checknumber (L, 3) - 1.0;
+      width = luaL_checknumber (L, 4);
+      height = luaL_checknumber (L, 5);
+    }
+
+  shown_width = gr->width;
+  shown_height = gr->height;
+
+  // shows the whole graphic, if it is not on the screen
+  status = avt_show_raw_image_region (&gr->data, shown_width, shown_height,
+				      x, y, width, height);
+
+  if (status <= AVT_ERROR)
+    {
+      return luaL_error (L, "%s", avt_get_error ());
+    }
+  else if (status == AVT_QUIT)
+    {
+      lua_pushnil (L);
+      return lua_error (L);
+    }
+
+  return 0;
+}
+
+
 static int
 lgraphic_size (lua_State * L)
 {
@@ -1108,6 +1673,87 @@ get_text_width (const struct avt_charenc *convert,
   return width;
 }
 
+/*
+ * glyphs of the font as horizontal spans of set pixels,
+ * shared by all graphics (the font is fixed)
+ */
+
+#define GLYPH_CACHE_SIZE  256	// must be a power of 2
+#define GLYPH_MAX_SPANS  128	// enough for any glyph up to 9x18 pixels
+
+struct glyph
+{
+  avt_char ch;
+  bool valid;
+  short int spans;
+  struct
+  {
+    uint_least8_t x, y, length;
+  } span[GLYPH_MAX_SPANS];
+};
+
+static struct glyph glyph_cache[GLYPH_CACHE_SIZE];
+
+static const struct glyph *
+get_glyph (avt_char ch, int fontwidth, int fontheight)
+{
+  struct glyph *g;
+  const uint8_t *font_line;	// pixel line from font definition
+
+  g = &glyph_cache[ch bitand (GLYPH_CACHE_SIZE - 1)];
+
+  if (g->valid and g->ch == ch)
+    return g;
+
+  // get the definition
+  font_line = (const uint8_t *) avt_get_font_char (ch);
+  if (not font_line)
+    font_line = (const uint8_t *) avt_get_font_char (0);
+
+  g->ch = ch;
+  g->valid = true;
+  g->spans = 0;
+
+  for (int ly = 0; ly < fontheight; ly++)
+    {
+      uint16_t line;		// normalized pixel line
+
+      if (fontwidth > CHAR_BIT)
+	{
+	  line = *(const uint16_t *) font_line;
+	  font_line += 2;
+	}
+      else
+	{
+	  line = *font_line << CHAR_BIT;
+	  font_line++;
+	}
+
+      // leftmost bit set, gets shifted to the right
+      int lx = 0;
+      while (lx < fontwidth and g->spans < GLYPH_MAX_SPANS)
+	{
+	  if (line bitand (0x8000 >> lx))
+	    {
+	      int start = lx;
+
+	      while (lx < fontwidth and (line bitand (0x8000 >> lx)))
+		lx++;
+
+	      g->span[g->spans].x = start;
+	      g->span[g->spans].y = ly;
+	      g->span[g->spans].length = lx - start;
+	      g->spans++;
+	    }
+	  else
+	    lx++;
+	}
+    }
+
+  return g;
+}
+
+
 // gr:text (string [,x ,y])
 static int
 lgraphic_text (lua_State * L)
@@ -1169,12 +1815,12 @@ lgraphic_text (lua_State * L)
   if (x >= width - fontwidth or x + ((int) txt_width * fontwidth) < 0)
     return 0;
 
+  // horizontal range of the displayed characters
+  int left = width, right = -1;
+
   // actally display the text
   while (len)
     {
-      const uint8_t *font_line;	// pixel line from font definition
-      uint16_t line;		// normalized pixel line might get modified
-
       avt_char wc;
       size_t bytes = convert->decode (convert, &wc, s);
       if (bytes > len)
@@ -1201,35 +1847,27 @@ lgraphic_text (lua_State * L)
       if (x > width - fontwidth)
 	break;
 
-      // get the definition
-      font_line = (const uint8_t *) avt_get_font_char (wc);
-      if (not font_line)
-	font_line = (const uint8_t *) avt_get_font_char (0);
+      // display character, it is completely inside the graphic
+      const struct glyph *g = get_glyph (wc, fontwidth, fontheight);
+      avt_color *base = gr->data + (y * width) + x;
 
-      // display character
-      for (int ly = 0; ly < fontheight; ly++)
+      for (int i = 0; i < g->spans; i++)
 	{
-	  if (fontwidth > CHAR_BIT)
-	    {
-	      line = *(const uint16_t *) font_line;
-	      font_line += 2;
-	    }
-	  else
-	    {
-	      line = *font_line << CHAR_BIT;
-	      font_line++;
-	    }
+	  avt_color *p = base + (g->span[i].y * width) + g->span[i].x;
 
-	  // leftmost bit set, gets shifted to the right in the for loop
-	  uint16_t scanbit = 0x8000;
-	  for (int lx = 0; lx < fontwidth; lx++, scanbit >>= 1)
-	    if (line bitand scanbit)
-	      putpixelcolor (gr, x + lx, y + ly, width, color);
-	}			// for (int ly...
+	  for (int n = g->span[i].length; n > 0; n--)
+	    *p++ = color;
+	}
+
+      left = avt_min (left, x);
+      right = avt_max (right, x + fontwidth - 1);
 
       x += fontwidth;
     }				// while
 
+  if (left <= right)
+    dirty (gr, left, y, right, y + fontheight - 1);
+
   return 0;
 }
 
@@ -1415,6 +2053,7 @@ lgraphic_put (lua_State * L)
     {
       memcpy (target + (yoffset * target_width), source,
 	      source_width * lines * BPP);
+      dirty (gr, 0, yoffset, target_width - 1, yoffset + lines - 1);
     }
   else
     {
@@ -1444,6 +2083,9 @@ lgraphic_put (lua_State * L)
 	  for (y = 0; y < lines; y++)
 	    memcpy (target + ((y + yoffset) * target_width) + xoffset,
 		    source + y * source_width + xstart, bytes);
+
+	  dirty (gr, xoffset, yoffset, xoffset + (bytes / BPP) - 1,
+		 yoffset + lines - 1);
 	}
     }
 
@@ -1507,6 +2149,10 @@ lgraphic_put_transparency (lua_State * L)
 	  xoffset = 0;
 	}
 
+      // not beyond the right border
+      if (show_width > target_width - xoffset)
+	show_width = target_width - xoffset;
+
       background = gr2->background;
 
       for (y = 0; y < lines; y++)
@@ -1521,6 +2167,10 @@ lgraphic_put_transparency (lua_State * L)
 		*pt = foreground;
 	    }
 	}
+
+      if (show_width > 0)
+	dirty (gr, xoffset, yoffset, xoffset + show_width - 1,
+	       yoffset + lines - 1);
     }
 
   return 0;
@@ -1542,6 +2192,7 @@ lgraphic_put_file (lua_State * L)
 
   avt_put_raw_image_file (filename, xoffset, yoffset,
 			  &gr->data, gr->width, gr->height);
+  dirty_all (gr);
 
   return 0;
 }
@@ -1624,6 +2275,8 @@ lgraphic_put_image (lua_State * L)
 			      &gr->data, gr->width, gr->height);
     }
 
+  dirty_all (gr);
+
   return 0;
 }
 
@@ -1692,6 +2345,8 @@ lgraphic_get (lua_State * L)
     memcpy (target + (y * target_width),
 	    source + y * source_width + x1, bytes);
 
+  dirty_all (gr2);
+
   return 1;
 }
 
@@ -1755,6 +2410,8 @@ lgraphic_shift_vertically (lua_State * L)
 
       for (i = 0; i < lines * width; i++)
 	*area++ = color;
+
+      dirty_all (gr);
     }
 
   return 0;
@@ -1810,6 +2467,8 @@ lgraphic_shift_horizontally (lua_State * L)
 	  for (x = 0; x < columns; x++)
 	    *p++ = color;
 	}
+
+      dirty_all (gr);
     }
 
   return 0;
@@ -1820,32 +2479,47 @@ static int
 lgraphic_export_ppm (lua_State * L)
 {
   graphic *gr;
-  avt_color *p;
   const char *fname;
-  FILE *f;
 
   gr = get_graphic (L, 1);
   fname = luaL_checkstring (L, 2);
 
-  f = fopen (fname, "wb");
+  if (avt_save_raw_image_ppm (fname, gr->data, gr->width, gr->height)
+      == AVT_FAILURE)
+    return luaL_error (L, LUA_QS ": %s", fname, avt_get_error ());
 
-  if (not f)
-    return luaL_error (L, LUA_QS ": %s", fname, strerror (errno));
+  return 0;
+}
 
-  fprintf (f, "P6\n%d %d\n255\n", gr->width, gr->height);
+static int
+lgraphic_export_qoi (lua_State * L)
+{
+  graphic *gr;
+  const char *fname;
 
-  p = gr->data;
-  for (size_t i = gr->height * gr->width; i > 0; i--, p++)
-    {
-      register avt_color color = *p;
+  gr = get_graphic (L, 1);
+  fname = luaL_checkstring (L, 2);
 
-      putc (avt_red (color), f);
-      putc (avt_green (color), f);
-      putc (avt_blue (color), f);
-    }
+  if (avt_save_raw_image_qoi (fname, gr->data, gr->width, gr->height)
+      == AVT_FAILURE)
+    return luaL_error (L, LUA_QS ": %s", fname, avt_get_error ());
+
+  return 0;
+}
+
+
+static int
+lgraphic_export_png (lua_State * L)
+{
+  graphic *gr;
+  const char *fname;
+
+  gr = get_graphic (L, 1);
+  fname = luaL_checkstring (L, 2);
 
-  if (fclose (f) != 0)
-    return luaL_error (L, LUA_QS ": %s", fname, strerror (errno));
+  if (avt_save_raw_image_png (fname, gr->data, gr->width, gr->height)
+      == AVT_FAILURE)
+    return luaL_error (L, LUA_QS ": %s", fname, avt_get_error ());
 
   return 0;
 }
@@ -1903,6 +2577,7 @@ lgraphic_set_resize_key (lua_State * L)
 static const luaL_Reg graphiclib[] = {
   {"new", lgraphic_new},
   {"fullsize", lgraphic_fullsize},
+  {"screenshot", lgraphic_screenshot},
   {"font_size", lgraphic_font_size},
   {"set_resize_key", lgraphic_set_resize_key},
   {"set_pointer_buttons_key", lgraphic_set_pointer_buttons_key},
@@ -1933,6 +2608,9 @@ static const luaL_Reg graphiclib_methods[] = {
   {"bar", lgraphic_bar},
   {"rectangle", lgraphic_rectangle},
   {"border3d", lgraphic_border3d},
+  {"polyline", lgraphic_polyline},
+  {"points", lgraphic_points},
+  {"bars", lgraphic_bars},
   {"arc", lgraphic_arc},
   {"circle", lgraphic_arc},
   {"disc", lgraphic_disc},
@@ -1940,6 +2618,7 @@ static const luaL_Reg graphiclib_methods[] = {
   {"textalign", lgraphic_textalign},
   {"font_size", lgraphic_font_size},
   {"show", lgraphic_show},
+  {"show_region", lgraphic_show_region},
   {"size", lgraphic_size},
   {"width", lgraphic_width},
   {"height", lgraphic_height},
@@ -1958,6 +2637,8 @@ static const luaL_Reg graphiclib_methods[] = {
   {"shift_vertically", lgraphic_shift_vertically},
   {"shift_horizontally", lgraphic_shift_horizontally},
   {"export_ppm", lgraphic_export_ppm},
+  {"export_qoi", lgraphic_export_qoi},
+  {"export_png", lgraphic_export_png},
   {NULL, NULL}
 };
 
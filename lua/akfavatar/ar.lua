@@ -45,6 +45,19 @@ function ar:open(filename, mode)
   self.__index = self
   obj.file = f
 
+  -- index of the header positions, so that seek doesn't have to search
+  -- like in a sequential search, the first member of a name wins
+  obj.index = {}
+  repeat
+    local size, name = obj:next()
+    if size == nil then
+      obj.index_error = name --> reported, when a member isn't found
+    elseif size ~= -1 and not obj.index[name] then
+      obj.index[name] = f:seek() - 60 --> the header has 60 bytes
+    end
+  until size == nil or size == -1
+  obj:rewind()
+
   return obj
 end
 
@@ -55,6 +68,8 @@ function ar:close()
   self.name=nil
   self.mode=nil
   self.member_size=nil
+  self.index=nil
+  self.index_error=nil
 end
 
 -- get next member
@@ -104,23 +119,19 @@ end
 -- on success it returns size, name, timestamp, uid, gid, mode
 -- on error it returns nil and an error message
 function ar:seek(member)
-  local size, name, timestamp, uid, gid, mode
+  local position = self.index[member]
+  if not position then
+    return nil, self.index_error
+                or self.name .. ": " .. member .. ": member not found"
+  end
 
-  size, name = self.file:seek("set", 8)
+  local size, msg = self.file:seek("set", position)
   self.member_size = 0
   if size == nil then
-    return nil, name
+    return nil, msg
   end
 
-  repeat
-    size, name, timestamp, uid, gid, mode = self:next()
-    if size == nil then return nil, name
-    elseif size == -1 then
-      return nil, self.name .. ": " .. member .. ": member not found"
-    end
-  until name == member
-
-  return size, name, timestamp, uid, gid, mode
+  return self:next()
 end
 
 -- gets content of a member as string
@@ -185,7 +185,7 @@ local function drop(column)
         clear_position(column, i+1)
         chip_position(column, i)
         avt.wait(0.025)
-        screen:show()
+        screen:show_region()
       end
     end
 
@@ -354,7 +354,7 @@ local function select_slot(column)
 
   repeat
     above(column, player)
-    screen:show()
+    screen:show_region()
     key=avt.get_key()
     if avt.key.left==key and column>1 then column = column - 1
     elseif avt.key.right==key and column<7 then column = column + 1
@@ -0,0 +1,114 @@
+#!/usr/bin/env lua-akfavatar
+
+-- Benchmark for the drawing functions of akfavatar-graphic
+-- run it with different versions of the library to compare them
+
+-- This file is dedicated to the Public Domain (CC0)
+-- http://creativecommons.org/publicdomain/zero/1.0/
+
+local avt = require "lua-akfavatar"
+local graphic = require "akfavatar-graphic"
+
+avt.encoding("UTF-8")
+avt.title("Graphic Benchmark")
+avt.start()
+
+local gr, width, height = graphic.new()
+local clock = os.clock
+
+-- the same pseudo random values on every run
+local seed = 12345
+local function random(max)
+  seed = (seed * 16807) % 2147483647
+  return seed % max + 1
+end
+
+local function measure(name, thickness, count, draw)
+  gr:clear()
+  gr:thickness(thickness)
+  seed = 12345
+  local start = clock()
+  for i = 1, count do draw(i) end
+  local seconds = clock() - start
+  gr:show()
+  return string.format("%-22s %8.1f ms\n", name, seconds * 1000)
+end
+
+local results = {}
+local function add(s) results[#results + 1] = s end
+
+local lines = 20000
+local function random_line()
+  gr:line(random(width), random(height), random(width), random(height))
+end
+
+-- partly outside of the graphic
+local function clipped_line()
+  gr:line(random(3 * width) - width, random(3 * height) - height,
+          random(3 * width) - width, random(3 * height) - height)
+end
+
+-- like function_plotter.lua: many short segments
+local function plot(i)
+  local x = (i % width) + 1
+  if x == 1 then gr:moveto(1, height / 2) end
+  gr:lineto(x, height / 2 - math.sin(x / 20 + i / width) * height / 3)
+end
+
+add(measure("lines", 1, lines, random_line))
+add(measure("lines, thickness 3", 3, lines / 10, random_line))
+add(measure("clipped lines", 1, lines, clipped_line))
+add(measure("plot segments", 1, 10 * width, plot))
+add(measure("plot, thickness 2", 2, 10 * width, plot))
+
+-- the same plot with one call per curve
+local curve = {}
+add(measure("plot, polyline", 1, 10, function(i)
+  for x = 1, width do
+    curve[2 * x - 1] = x
+    curve[2 * x] = height / 2 - math.sin(x / 20 + i) * height / 3
+  end
+  gr:polyline(curve)
+end))
+
+add(measure("bars", 1, 1, function()
+  local bars = {}
+  for i = 1, 2000 do
+    local x, y = random(width), random(height)
+    bars[i] = {x, y, x + random(50), y + random(50)}
+  end
+  gr:bars(bars)
+end))
+
+local middle = math.min(width, height) / 2
+
+add(measure("discs", 1, 2000, function(i)
+  gr:disc(i % middle, random(width), random(height))
+end))
+
+add(measure("circles", 1, 2000, function(i)
+  gr:moveto(width / 2, height / 2)
+  gr:circle(i % middle)
+end))
+
+add(measure("arcs", 1, 2000, function(i)
+  gr:moveto(width / 2, height / 2)
+  gr:arc(i % middle, random(360), random(360))
+end))
+
+add(measure("circles, thickness 3", 3, 200, function(i)
+  gr:moveto(width / 2, height / 2)
+  gr:circle(i % middle)
+end))
+
+add(measure("text", 1, 2000, function(i)
+  gr:text("The quick brown fox jumps over the lazy dog",
+          random(width), random(height))
+end))
+
+-- also for the headless backend (configure --with-headless)
+io.write(table.concat(results))
+
+avt.set_balloon_size(#results + 1, 40)
+avt.say(table.concat(results))
+avt.wait_button()
@@ -430,35 +430,38 @@ run_executable (const char *filename)
 {
   int status;
   size_t size;
-  char *script, *start;
+  avt_archive *archive;
+  const char *start;
 
-  script = avt_arch_get_data (filename, NAME_EXEC, &size);
+  archive = avt_archive_open (filename);
+  start = avt_archive_member (archive, NAME_EXEC, &size);
 
-  if (not script)
+  if (not start)
     {
+      avt_archive_close (archive);
       lua_pushfstring (L, "%s: error in executable", filename);
       return -1;
     }
 
-  start = script;
-
   // skip UTF-8 BOM
-  if (start[0] == '\xEF' and start[1] == '\xBB' and start[2] == '\xBF')
+  if (size >= 3 and start[0] == '\xEF' and start[1] == '\xBB'
+      and start[2] == '\xBF')
     {
       start += 3;
       size -= 3;
     }
 
   // skip #! line
-  if (start[0] == '#' and start[1] == '!')
-    while (*start != '\n')
+  if (size >= 2 and start[0] == '#' and start[1] == '!')
+    while (size and *start != '\n')
       {
 	start++;
 	size--;
       }
 
+  // the script is read directly from the archive
   status = luaL_loadbufferx (L, start, size, filename, "t");
-  free (script);
+  avt_archive_close (archive);
 
   arg0 (filename);
 
@@ -661,6 +661,7 @@ lavt_avatar_image (lua_State * L)
 	}
 
       avt_avatar_image_xpm (xpm);
+      avt_image_cache_forget (xpm);
       free (xpm);
     }
   else				// not a table
@@ -753,6 +754,7 @@ lavt_show_image (lua_State * L)
       if (xpm)
 	{
 	  lua_pushboolean (L, (int) (avt_show_image_xpm (xpm) == AVT_NORMAL));
+	  avt_image_cache_forget (xpm);
 	  free (xpm);
 	}
       else
@@ -1361,6 +1363,136 @@ lavt_ticks (lua_State * L)
   return 1;
 }
 
+// monotonic time in nanoseconds since the start
+static int
+lavt_ticks_ns (lua_State * L)
+{
+  lua_pushnumber (L, (lua_Number) avt_ticks_ns ());
+  return 1;
+}
+
+// sleep until a value of avt.ticks_ns() is reached
+static int
+lavt_sleep_until (lua_State * L)
+{
+  lua_Number deadline = luaL_checknumber (L, 1);
+
+  is_initialized ();
+
+  if (deadline > 0)
+    check (avt_sleep_until ((uint_least64_t) deadline));
+
+  return 0;
+}
+
+// set the budget of the image cache in bytes (0 disables it)
+static int
+lavt_image_cache (lua_State * L)
+{
+  lua_Number bytes = luaL_checknumber (L, 1);
+
+  luaL_argcheck (L, bytes >= 0, 1, "must not be negative");
+  avt_set_image_cache ((size_t) bytes);
+
+  return 0;
+}
+
+// returns hits, misses, bytes
+static int
+lavt_image_cache_statistics (lua_State * L)
+{
+  size_t hits, misses, bytes;
+
+  avt_image_cache_statistics (&hits, &misses, &bytes);
+  lua_pushnumber (L, hits);
+  lua_pushnumber (L, misses);
+  lua_pushnumber (L, bytes);
+
+  return 3;
+}
+
+// returns a table with the performance counters
+static int
+lavt_stats (lua_State * L)
+{
+  uint_least64_t values[AVT_STAT_COUNT];
+  size_t count;
+
+  count = avt_get_stats (values, AVT_STAT_COUNT);
+  lua_createtable (L, 0, (int) count);
+
+  for (size_t i = 0; i < count; i++)
+    {
+      lua_pushnumber (L, (lua_Number) values[i]);
+      lua_setfield (L, -2, avt_stat_name ((int) i));
+    }
+
+  return 1;
+}
+
+static int
+lavt_reset_stats (lua_State * L)
+{
+  (void) L;
+  avt_reset_stats ();
+  return 0;
+}
+
+// starts tracing into the file, or stops it without a file
+// returns true or nil and an error message
+static int
+lavt_trace (lua_State * L)
+{
+  if (avt_trace (luaL_optstring (L, 1, NULL)) == AVT_FAILURE)
+    {
+      lua_pushnil (L);
+      lua_pushstring (L, avt_get_error ());
+      return 2;
+    }
+
+  lua_pushboolean (L, true);
+  return 1;
+}
+
+/*
+ * wrapper for the functions of the module, when tracing is wanted
+ * upvalue 1: name, upvalue 2: function
+ * when the function raises an error, the end of the event is missing
+ */
+static int
+traced (lua_State * L)
+{
+  const char *name;
+  int arguments;
+
+  name = (const char *) lua_touserdata (L, lua_upvalueindex (1));
+  arguments = lua_gettop (L);
+
+  lua_pushvalue (L, lua_upvalueindex (2));
+  lua_insert (L, 1);
+
+  avt_trace_begin (name);
+  lua_call (L, arguments, LUA_MULTRET);
+  avt_trace_end (name);
+
+  return lua_gettop (L);
+}
+
+// saves the screen, format depends on the extension
+static int
+lavt_screenshot (lua_State * L)
+{
+  const char *fname;
+
+  is_initialized ();
+  fname = luaL_checkstring (L, 1);
+
+  if (avt_screenshot (fname) == AVT_FAILURE)
+    return luaL_error (L, LUA_QS ": %s", fname, avt_get_error ());
+
+  return 0;
+}
+
 // show final credits from a string
 // 1=text, 2=centered (true/false/nothing)
 static int
@@ -2747,6 +2879,8 @@ static const luaL_Reg akfavtlib[] = {
   {"update", lavt_update},
   {"wait", lavt_wait_sec},
   {"ticks", lavt_ticks},
+  {"ticks_ns", lavt_ticks_ns},
+  {"sleep_until", lavt_sleep_until},
   {"set_balloon_size", lavt_set_balloon_size},
   {"set_balloon_width", lavt_set_balloon_width},
   {"set_balloon_height", lavt_set_balloon_height},
@@ -2776,6 +2910,12 @@ static const luaL_Reg akfavtlib[] = {
   {"show_avatar", lavt_show_avatar},
   {"show_image", lavt_show_image},
   {"show_image_file", lavt_show_image_file},
+  {"image_cache", lavt_image_cache},
+  {"image_cache_statistics", lavt_image_cache_statistics},
+  {"stats", lavt_stats},
+  {"reset_stats", lavt_reset_stats},
+  {"trace", lavt_trace},
+  {"screenshot", lavt_screenshot},
   {"credits", lavt_credits},
   {"move_in", lavt_move_in},
   {"move_out", lavt_move_out},
@@ -2990,6 +3130,18 @@ open_lua_akfavatar (lua_State * L)
 
   luaL_newlib (L, akfavtlib);
 
+  // with tracing every call of the module is an event
+  if (getenv ("AVT_TRACE"))
+    {
+      for (const luaL_Reg * r = akfavtlib; r->name; r++)
+	{
+	  lua_pushlightuserdata (L, (void *) r->name);
+	  lua_getfield (L, -2, r->name);
+	  lua_pushcclosure (L, traced, 2);
+	  lua_setfield (L, -2, r->name);
+	}
+    }
+
   // make a reference in the registry
   lua_pushvalue (L, -1);
   lua_setfield (L, LUA_REGISTRYINDEX, AVTMODULE);
@@ -18,30 +18,127 @@
  * along with this program; if not, see <http://www.gnu.org/licenses/>.
  */
 
+/*
+ * The time is taken from the performance counter.
+ * With virtual time (for the headless backend) the time only
+ * advances, when somebody sleeps, and sleeping takes no real time.
+ */
+
 #include "akfavatar.h"
+#include "avtinternals.h"
 #include <windows.h>
 #include <iso646.h>
 
-static DWORD start_ticks;
+// slices for avt_sleep_until, so that events are handled
+#define SLEEP_SLICE  (100 * UINT64_C (1000000))
+
+static uint_least64_t start_ns;
+static bool virtual_time;
+static uint_least64_t virtual_ns;
+
+// absolute time in nanoseconds, never virtual
+extern uint_least64_t
+avt_clock_ns (void)
+{
+  static LARGE_INTEGER frequency;
+  LARGE_INTEGER count;
+
+  if (not frequency.QuadPart)
+    QueryPerformanceFrequency (&frequency);
+
+  QueryPerformanceCounter (&count);
+
+  // split to avoid an overflow
+  return (uint_least64_t) (count.QuadPart / frequency.QuadPart) * 1000000000u
+    + (uint_least64_t) (count.QuadPart % frequency.QuadPart) * 1000000000u
+    / frequency.QuadPart;
+}
+
+extern uint_least64_t
+avt_ticks_ns (void)
+{
+  if (virtual_time)
+    return virtual_ns;
+
+  uint_least64_t now = avt_clock_ns ();
+
+  if (not start_ns)
+    start_ns = now - 1;		// never 0
+
+  return now - start_ns;
+}
 
 extern size_t
 avt_ticks (void)
 {
-  DWORD now;
+  return (size_t) (avt_ticks_ns () / 1000000u);
+}
 
-  now = GetTickCount ();
+// sleeps until the deadline without handling events
+extern void
+avt_delay_until (uint_least64_t deadline)
+{
+  uint_least64_t now;
+
+  now = avt_ticks_ns ();
+
+  if (deadline <= now)
+    return;
+
+  if (virtual_time)
+    {
+      virtual_ns = deadline;
+      return;
+    }
+
+  // Sleep only has milliseconds
+  Sleep ((DWORD) ((deadline - now + 999999u) / 1000000u));
+}
+
+extern int
+avt_sleep_until (uint_least64_t deadline)
+{
+  uint_least64_t now;
+
+  avt_trace_begin ("sleep");
+  now = avt_ticks_ns ();
+
+  while (now < deadline and _avt_STATUS == AVT_NORMAL)
+    {
+      if (deadline - now > SLEEP_SLICE)
+	avt_delay_until (now + SLEEP_SLICE);
+      else
+	avt_delay_until (deadline);
+
+      avt_update ();
+      now = avt_ticks_ns ();
+    }
 
-  if (not start_ticks)
-    start_ticks = now;
+  avt_trace_end ("sleep");
 
-  if (now >= start_ticks)
-    return (now - start_ticks);
-  else				// overrun
-    return (now + (0xFFFFFFFFu - start_ticks));
+  return _avt_STATUS;
 }
 
 extern void
 avt_delay (int milliseconds)
 {
-  Sleep (milliseconds);
+  if (milliseconds > 0)
+    avt_delay_until (avt_ticks_ns ()
+		     + (uint_least64_t) milliseconds * 1000000u);
+}
+
+// the ticks continue from where they are when switching
+extern void
+avt_virtual_time (bool on)
+{
+  if (on and not virtual_time)
+    {
+      virtual_ns = avt_ticks_ns ();
+      virtual_time = true;
+    }
+  else if (not on and virtual_time)
+    {
+      virtual_time = false;
+      start_ns = avt_clock_ns () - virtual_ns;
+    }
 }
@@ -8,6 +8,26 @@
 # notice and this notice are preserved.  This file is offered as-is,
 # without any warranty.
 
+# The result also has a table sorted by the normalized names
+# (lower case without spaces) for a binary search.
+# Run it with LC_ALL=C for a reliable sort order.
+
+# lower case without spaces
+function normalize(s)
+{
+  s = tolower(s)
+  gsub(/[ \t]/, "", s)
+  return s
+}
+
+function add_key(key, value)
+{
+  if (key in seen) return
+  seen[key] = 1
+  keys[++count] = key
+  values[count] = value
+}
+
 BEGIN	{ if (name == "") name = "palette"
 	  if (default_color == "") default_color = "0x000000"
 	  # must be a string
@@ -22,6 +42,9 @@ BEGIN	{ if (name == "") name = "palette"
 	  print "static const struct { int number; const char *name; }"
 	  print name "[] = {"
 	  printf "  {DEFAULT_COLOR, \"default\"}"
+
+	  count = 0
+	  add_key("default", "DEFAULT_COLOR")
 	}
 
 /^!/	{ next }
@@ -29,12 +52,41 @@ BEGIN	{ if (name == "") name = "palette"
 NF < 4	{ next }
 
 	{ print ","
-	  printf "  {0x%02X%02X%02X, \"", $1, $2, $3
+	  value = sprintf("0x%02X%02X%02X", $1, $2, $3)
+	  printf "  {%s, \"", value
+	  key = ""
 	  for (i = 4; i <= NF; i++)
-	    if (i < NF) printf "%s ", $i
-	           else printf "%s\"}", $i
+	    {
+	      if (i < NF) printf "%s ", $i
+	             else printf "%s\"}", $i
+	      key = key $i
+	    }
+	  add_key(normalize(key), value)
 	}
 
 END	{ print "\n};"
+
+	  # insertion sort, the table is small
+	  for (i = 2; i <= count; i++)
+	    {
+	      key = keys[i]
+	      value = values[i]
+	      for (j = i - 1; j > 0 && keys[j] > key; j--)
+	        {
+	          keys[j + 1] = keys[j]
+	          values[j + 1] = values[j]
+	        }
+	      keys[j + 1] = key
+	      values[j + 1] = value
+	    }
+
+	  print ""
+	  print "/* sorted by normalized names (lower case without spaces) */"
+	  print "static const struct { const char *key; int number; }"
+	  print name "_sorted[] = {"
+	  for (i = 1; i <= count; i++)
+	    printf "  {\"%s\", %s}%s\n", keys[i], values[i], \
+	           (i < count) ? "," : ""
+	  print "};"
 	  print "\n#endif /* RGB_H */"
 	}
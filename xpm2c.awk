@@ -0,0 +1,204 @@
+#!/usr/bin/awk -f
+
+# xpm2c - Convert an XPM image into prebuilt pixel data for AKFAvatar
+#
+# Copyright (c) 2015 Andreas K. Foerster
+# Copying and distribution of this file, with or without modification,
+# are permitted in any medium without royalty provided the copyright
+# notice and this notice are preserved.  This file is offered as-is,
+# without any warranty.
+
+# The result defines an array of avt_color values and a
+# struct avt_image (see avtgraphic.h), which can be loaded with
+# avt_load_image_prebuilt without any parsing at runtime.
+#
+# Example-Usages:
+#   awk -f xpm2c.awk btn.xpm > btn_image.h
+#   awk -f xpm2c.awk -v name=button -v rgb=rgb.txt btn.xpm > btn_image.h
+#
+# Without a name it is deduced from the name of the array in the XPM file.
+# Color names are only supported with an rgb.txt file.
+
+function error(text)
+{
+  print "xpm2c: " FILENAME ": " text > "/dev/stderr"
+  failed = 1
+  exit 1
+}
+
+function hexvalue(s,    i, v)
+{
+  v = 0
+  for (i = 1; i <= length(s); i++)
+    v = v * 16 + index("0123456789ABCDEF", substr(s, i, 1)) - 1
+  return v
+}
+
+# returns the color as C expression
+function color(spec,    s, l, n)
+{
+  s = toupper(spec)
+
+  if (s == "NONE")
+    {
+      transparent = "true"
+      return "AVT_TRANSPARENT"
+    }
+
+  if (s ~ /^#[0-9A-F]+$/)
+    {
+      s = substr(s, 2)
+      l = length(s)
+
+      if (l == 3)  # #RGB
+        return sprintf("0x%02X%02X%02X", 17 * hexvalue(substr(s, 1, 1)),
+                       17 * hexvalue(substr(s, 2, 1)),
+                       17 * hexvalue(substr(s, 3, 1)))
+
+      if (l % 3 == 0 && l <= 12)  # use the upper 8 bits
+        {
+          l = l / 3
+          return sprintf("0x%02X%02X%02X",
+                         int(hexvalue(substr(s, 1, l)) / 16 ^ (l - 2)),
+                         int(hexvalue(substr(s, l + 1, l)) / 16 ^ (l - 2)),
+                         int(hexvalue(substr(s, 2 * l + 1, l)) / 16 ^ (l - 2)))
+        }
+    }
+
+  n = tolower(spec)
+  gsub(/ /, "", n)
+
+  if (n in rgbname)
+    return rgbname[n]
+
+  error("unknown color \"" spec "\"")
+}
+
+# the value for the key "c" or as fallback of another visual
+function colorspec(s,    w, n, i, key, value, result)
+{
+  n = split(s, w, /[ \t]+/)
+  result = ""
+  key = ""
+  value = ""
+
+  for (i = 1; i <= n + 1; i++)
+    {
+      if (i > n || w[i] == "c" || w[i] == "m" || w[i] == "g" \
+          || w[i] == "g4" || w[i] == "s")
+        {
+          if (key == "c" || (key != "s" && key != "" && result == ""))
+            result = value
+          key = w[i]
+          value = ""
+        }
+      else if (w[i] != "")
+        value = (value == "") ? w[i] : value " " w[i]
+    }
+
+  if (result == "") error("no color in \"" s "\"")
+
+  return result
+}
+
+BEGIN \
+{
+  if (rgb != "")
+    {
+      while ((getline line < rgb) > 0)
+        {
+          if (line ~ /^!/) continue
+          split(line, w, /[ \t]+/)
+          sub(/^[ \t]*[0-9]+[ \t]+[0-9]+[ \t]+[0-9]+[ \t]+/, "", line)
+          gsub(/ /, "", line)
+          if (line != "")
+            rgbname[tolower(line)] = sprintf("0x%02X%02X%02X", \
+                                             w[1], w[2], w[3])
+        }
+      close(rgb)
+    }
+
+  strings = 0
+  transparent = "false"
+}
+
+# the name of the array
+strings == 0 && /\[\][ \t]*=/ \
+{
+  if (name == "")
+    {
+      name = $0
+      sub(/\[\].*/, "", name)
+      sub(/.*[ \t*]/, "", name)
+      sub(/_xpm$/, "", name)
+    }
+}
+
+/"/ \
+{
+  if ($0 ~ /\\"/) error("escaped quotes are not supported")
+
+  s = $0
+  sub(/^[^"]*"/, "", s)
+  sub(/".*/, "", s)
+
+  if (strings == 0)
+    {
+      split(s, v, /[ \t]+/)
+      if (v[1] == "") { v[1] = v[2]; v[2] = v[3]; v[3] = v[4]; v[4] = v[5] }
+      width = v[1] + 0
+      height = v[2] + 0
+      ncolors = v[3] + 0
+      cpp = v[4] + 0
+
+      if (width <= 0 || height <= 0 || ncolors <= 0 || cpp <= 0)
+        error("bad values \"" s "\"")
+
+      if (name == "") name = "image"
+    }
+  else if (strings <= ncolors)
+    code[substr(s, 1, cpp)] = color(colorspec(substr(s, cpp + 1)))
+  else if (strings <= ncolors + height)
+    {
+      if (length(s) != width * cpp) error("bad line length")
+
+      if (strings == ncolors + 1)
+        {
+          source = FILENAME
+          sub(/.*\//, "", source)
+          print "/* automatically generated by xpm2c from " source " */"
+          print ""
+          print "static const avt_color " name "_pixels[] = {"
+        }
+
+      line = " "
+      for (x = 0; x < width; x++)
+        {
+          c = substr(s, x * cpp + 1, cpp)
+          if (!(c in code)) error("undefined color \"" c "\"")
+          item = " " code[c] ","
+          if (length(line) + length(item) > 78)
+            {
+              print line
+              line = " "
+            }
+          line = line item
+        }
+      print line
+    }
+
+  strings++
+}
+
+END \
+{
+  if (failed) exit 1
+
+  if (strings < ncolors + height + 1) error("incomplete image")
+
+  print "};"
+  print ""
+  print "static const struct avt_image " name "_image = {"
+  print "  " width ", " height ", " transparent ", " name "_pixels"
+  print "};"
+}